@@ -9,27 +9,93 @@ CMD_SRCS += \
 ../lnk_msp430f2618.cmd 
 
 C_SRCS += \
+../arena.c \
+../env.c \
+../fft.c \
+../filter.c \
+../fixmath.c \
+../freq.c \
+../goertzel.c \
+../kernel.c \
 ../main.c \
-../time.c 
+../nlms.c \
+../pack12.c \
+../time.c \
+../xcorr.c 
 
 C_DEPS += \
+./arena.d \
+./env.d \
+./fft.d \
+./filter.d \
+./fixmath.d \
+./freq.d \
+./goertzel.d \
+./kernel.d \
 ./main.d \
-./time.d 
+./nlms.d \
+./pack12.d \
+./time.d \
+./xcorr.d 
 
 OBJS += \
+./arena.obj \
+./env.obj \
+./fft.obj \
+./filter.obj \
+./fixmath.obj \
+./freq.obj \
+./goertzel.obj \
+./kernel.obj \
 ./main.obj \
-./time.obj 
+./nlms.obj \
+./pack12.obj \
+./time.obj \
+./xcorr.obj 
 
 OBJS__QUOTED += \
+"arena.obj" \
+"env.obj" \
+"fft.obj" \
+"filter.obj" \
+"fixmath.obj" \
+"freq.obj" \
+"goertzel.obj" \
+"kernel.obj" \
 "main.obj" \
-"time.obj" 
+"nlms.obj" \
+"pack12.obj" \
+"time.obj" \
+"xcorr.obj" 
 
 C_DEPS__QUOTED += \
+"arena.d" \
+"env.d" \
+"fft.d" \
+"filter.d" \
+"fixmath.d" \
+"freq.d" \
+"goertzel.d" \
+"kernel.d" \
 "main.d" \
-"time.d" 
+"nlms.d" \
+"pack12.d" \
+"time.d" \
+"xcorr.d" 
 
 C_SRCS__QUOTED += \
+"../arena.c" \
+"../env.c" \
+"../fft.c" \
+"../filter.c" \
+"../fixmath.c" \
+"../freq.c" \
+"../goertzel.c" \
+"../kernel.c" \
 "../main.c" \
-"../time.c" 
+"../nlms.c" \
+"../pack12.c" \
+"../time.c" \
+"../xcorr.c" 
 
 
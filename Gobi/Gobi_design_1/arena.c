@@ -0,0 +1,66 @@
+/*
+ * arena.c
+ *
+ *  Bump allocator over the sample arena. Regions are handed out in order
+ *  and only released all at once (Arena_Reset) or back to a mark, so there
+ *  is no fragmentation and no per-block header.
+ */
+
+#include "arena.h"
+
+static unsigned int arena[ARENA_BYTES / 2];     // word aligned for DMA
+static unsigned int arenaUsed = 0;              // words handed out
+
+/***************************************************************************************
+ * Function: Arena_Reset()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Releases every region. Nothing may still be using them (stop DMA first).       *
+ ***************************************************************************************/
+void Arena_Reset(void) {
+    arenaUsed = 0;
+}
+
+/***************************************************************************************
+ * Function: Arena_Alloc()                                                             *
+ * Input Parameters: bytes - size of the region                                        *
+ * Output: word-aligned region, or 0 if it does not fit                                *
+ * Description:                                                                        *
+ *      Takes the next region from the arena. Consecutive calls return                 *
+ *      adjacent regions.                                                              *
+ ***************************************************************************************/
+void *Arena_Alloc(unsigned int bytes) {
+    unsigned int words = (bytes + 1) >> 1;
+    void *p;
+
+    if (words > ARENA_BYTES / 2 - arenaUsed)
+        return 0;
+    p = &arena[arenaUsed];
+    arenaUsed += words;
+    return p;
+}
+
+/***************************************************************************************
+ * Function: Arena_Free()                                                              *
+ * Input Parameters: NONE                                                              *
+ * Output: bytes still available                                                       *
+ ***************************************************************************************/
+unsigned int Arena_Free(void) {
+    return (ARENA_BYTES / 2 - arenaUsed) << 1;
+}
+
+/***************************************************************************************
+ * Function: Arena_Mark() / Arena_Release()                                            *
+ * Description:                                                                        *
+ *      Scratch space for one mode: take a mark on entry, allocate, and release        *
+ *      back to the mark on exit. The capture regions below the mark are kept.         *
+ ***************************************************************************************/
+unsigned int Arena_Mark(void) {
+    return arenaUsed;
+}
+
+void Arena_Release(unsigned int mark) {
+    if (mark < arenaUsed)
+        arenaUsed = mark;
+}
@@ -0,0 +1,33 @@
+/*
+ * arena.h
+ *
+ *  Single RAM region that holds every sample buffer. It is carved into
+ *  per-channel and per-stage regions at run time instead of being fixed
+ *  at compile time, so capture length can be traded against channels.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+// RAM is 0x1100..0x30FF (8K). The arena gets what the rest leaves, rounded
+// down to 64 bytes: 6976, or 3488 samples of A2 alone and 1744 each of A2 and
+// A1 (the 7680 of the fixed buffers no longer fit). The other globals come
+// to about 480 bytes with 4-byte pointers (--data_model=restricted), counted
+// from a host build, not a cl430 map; the allowance keeps about 90 bytes over
+// that, and the linker stops with a RAM overflow if they outgrow it. Check
+// the .bss and .data totals in the map after adding globals.
+#define ARENA_RAM_BYTES     8192
+#define ARENA_STACK_BYTES   320         // --stack_size: printf alone takes ~150
+#define ARENA_HEAP_BYTES    80          // --heap_size
+#define ARENA_RTS_BYTES     210         // .data of the run-time library (stdio table)
+#define ARENA_OTHER_BYTES   576         // .bss/.data of the modules
+#define ARENA_BYTES     ((ARENA_RAM_BYTES - ARENA_STACK_BYTES - ARENA_HEAP_BYTES \
+                          - ARENA_RTS_BYTES - ARENA_OTHER_BYTES) & ~63)
+
+void Arena_Reset(void);
+void *Arena_Alloc(unsigned int bytes);
+unsigned int Arena_Free(void);
+unsigned int Arena_Mark(void);
+void Arena_Release(unsigned int mark);
+
+#endif /* ARENA_H_ */
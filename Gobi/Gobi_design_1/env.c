@@ -0,0 +1,175 @@
+/*
+ * env.c
+ *
+ *  Envelope and RMS detector (see env.h).
+ *
+ *  Per sample: the deviation from the DC level is clamped to 12 bits,
+ *  its magnitude added to the point's sum, and the window updated with
+ *      sq += x^2 - old^2 = (x - old) * (x + old)
+ *  which is one 16x16 multiply. About 45 cycles in all, so it keeps up
+ *  next to the subtraction at 125k samples/s. Per point there is one
+ *  32/16 divide for the average and a Fix_Sqrt(), about 1000 cycles
+ *  every decim samples. Lapped blocks are not treated as gaps: the
+ *  samples lost only shorten the time a point covers.
+ */
+
+#include "gfa.h"
+#include "fixmath.h"
+#include "env.h"
+
+static int *envWin;                     // last 2^envShift deviations, a ring
+static struct EnvPoint *envRing;
+static unsigned int envShift;
+static unsigned int envSmooth;          // one-pole weight 2^-envSmooth per point
+static unsigned int envDecim;           // samples per point
+static unsigned int envPos;             // oldest window sample, replaced next
+static unsigned long envSq;             // sum of squares over the window
+static unsigned long envAbs;            // sum of |x| towards the next point
+static unsigned int envLeft;            // samples until the next point
+static unsigned int envLevel;           // smoothed envelope, Q(ENV_FRAC)
+static unsigned int envHead = 0;        // next point written
+static unsigned int envCount = 0;       // points held
+static unsigned int envDropped = 0;     // points overwritten before they were read
+static unsigned long envSeq = 0;        // points made, the next one's number
+
+/***************************************************************************************
+ * Function: Env_Init()                                                                *
+ * Input Parameters: mem    - ENV_BYTES(shift) of word-aligned RAM                     *
+ *                   shift  - RMS window of 2^shift samples, 1..ENV_MAX_SHIFT          *
+ *                   smooth - envelope follows each point with 2^-smooth weight,       *
+ *                            0..ENV_MAX_SMOOTH                                        *
+ *                   decim  - samples per point, at least 1                            *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Starts with no points held.                                                    *
+ ***************************************************************************************/
+void Env_Init(int *mem, unsigned int shift, unsigned int smooth, unsigned int decim) {
+    envWin = mem;
+    envRing = (struct EnvPoint *) (mem + (1U << shift));
+    envShift = shift;
+    envSmooth = smooth;
+    envDecim = decim;
+    envHead = 0;
+    envCount = 0;
+    envDropped = 0;
+    envSeq = 0;
+    Env_Restart();
+}
+
+/***************************************************************************************
+ * Function: Env_Restart()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Empties the window and the point in progress; points already made are          *
+ *      kept. The RMS builds up over the first window, the envelope over about         *
+ *      2^smooth points.                                                               *
+ ***************************************************************************************/
+void Env_Restart(void) {
+    unsigned int k;
+
+    for (k = 0; k < (1U << envShift); k++)
+        envWin[k] = 0;
+    envPos = 0;
+    envSq = 0;
+    envAbs = 0;
+    envLeft = envDecim;
+    envLevel = 0;
+}
+
+/***************************************************************************************
+ * Function: Env_Point()                                                               *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Closes a point and queues it. The window mean square is scaled into            *
+ *      Q(2 * ENV_FRAC) before the root; it stays below 2^31 for any shift.            *
+ ***************************************************************************************/
+static void Env_Point(void) {
+    unsigned int mean = (unsigned int) ((envAbs << ENV_FRAC) / envDecim);
+    unsigned long ms;
+    struct EnvPoint *pt;
+
+    envLevel += (int) (((long) mean - envLevel) >> envSmooth);
+    if (envShift >= 2 * ENV_FRAC)
+        ms = envSq >> (envShift - 2 * ENV_FRAC);
+    else
+        ms = envSq << (2 * ENV_FRAC - envShift);
+
+    pt = &envRing[envHead];
+    pt->env = envLevel;
+    pt->rms = Fix_Sqrt(ms);
+    envHead = (envHead + 1) % ENV_RING;
+    if (envCount < ENV_RING)
+        envCount++;
+    else
+        envDropped++;
+    envSeq++;
+    envAbs = 0;
+    envLeft = envDecim;
+}
+
+/***************************************************************************************
+ * Function: Env_Block()                                                               *
+ * Input Parameters: p            - processed results                                  *
+ *                   first, count - block to add                                       *
+ *                   mid          - DC level of the results                            *
+ * Output: NONE                                                                        *
+ ***************************************************************************************/
+void Env_Block(const volatile unsigned int *p, unsigned int first, unsigned int count,
+               int mid) {
+    unsigned int i;
+    unsigned int last = first + count;
+    unsigned int mask = (1U << envShift) - 1;
+    int x, old;
+
+    for (i = first; i < last; i++) {
+        x = (int) p[i] - mid;
+        if (x > 2047)               // results can swing past 12 bits
+            x = 2047;
+        else if (x < -2047)
+            x = -2047;
+        envAbs += (x < 0) ? -x : x;
+
+        old = envWin[envPos];
+        envWin[envPos] = x;
+        envPos = (envPos + 1) & mask;
+        envSq += (long) (x - old) * (x + old);
+
+        if (--envLeft == 0)
+            Env_Point();
+    }
+}
+
+/***************************************************************************************
+ * Function: Env_Read()                                                                *
+ * Input Parameters: NONE                                                              *
+ * Output: 1 with the oldest point held in pt and its number in seq, 0 if there        *
+ *         is none                                                                     *
+ ***************************************************************************************/
+int Env_Read(struct EnvPoint *pt, unsigned long *seq) {
+    if (envCount == 0)
+        return 0;
+    *pt = envRing[(envHead + ENV_RING - envCount) % ENV_RING];
+    *seq = envSeq - envCount;
+    envCount--;
+    return 1;
+}
+
+/***************************************************************************************
+ * Function: Env_Next()                                                                *
+ * Input Parameters: NONE                                                              *
+ * Output: number the next point will get                                              *
+ ***************************************************************************************/
+unsigned long Env_Next(void) {
+    return envSeq;
+}
+
+/***************************************************************************************
+ * Function: Env_Dropped()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: points overwritten before they were read                                    *
+ ***************************************************************************************/
+unsigned int Env_Dropped(void) {
+    return envDropped;
+}
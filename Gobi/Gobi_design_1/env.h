@@ -0,0 +1,37 @@
+/*
+ * env.h
+ *
+ *  Amplitude of one channel as a stream of decimated points instead of
+ *  its waveform. Each point holds the envelope, the rectified signal
+ *  averaged over the decim samples since the last point and smoothed by a
+ *  one-pole low-pass at the point rate, and the RMS over a sliding
+ *  window of the last 2^shift samples, kept as a running sum of squares.
+ *  Both are around the DC level and in Q(ENV_FRAC) ADC12 counts; the
+ *  envelope of a sine is 2/pi of its peak, the RMS 1/sqrt(2).
+ *  Points wait in a ring until read; when it is full the oldest goes.
+ */
+
+#ifndef ENV_H_
+#define ENV_H_
+
+#define ENV_FRAC            4
+#define ENV_MAX_SHIFT       9           // window up to 512 samples: 2^31 sum of squares
+#define ENV_MAX_SMOOTH      8
+#define ENV_RING            32          // points held until read
+
+struct EnvPoint {
+    unsigned int env;
+    unsigned int rms;
+};
+
+#define ENV_BYTES(shift)    ((sizeof(int) << (shift)) + ENV_RING * sizeof(struct EnvPoint))
+
+void Env_Init(int *mem, unsigned int shift, unsigned int smooth, unsigned int decim);
+void Env_Restart(void);
+void Env_Block(const volatile unsigned int *p, unsigned int first, unsigned int count,
+               int mid);
+int Env_Read(struct EnvPoint *pt, unsigned long *seq);
+unsigned long Env_Next(void);
+unsigned int Env_Dropped(void);
+
+#endif /* ENV_H_ */
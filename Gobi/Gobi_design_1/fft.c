@@ -0,0 +1,266 @@
+/*
+ * fft.c
+ *
+ *  Real FFT with block floating point (see fft.h).
+ *
+ *  Cost at 16MHz for 512 points (a 256-point complex FFT): 1024
+ *  butterflies of about 60 cycles, a peak scan per stage, the split step
+ *  and 256 square roots, in all about 15ms. Every product goes through
+ *  the 16x16 hardware multiplier. The result is |X[k]| >> exp for bins
+ *  k = 0..n/2-1 of the windowed block, in the units of the Q15 input;
+ *  the Hann window halves a tone's amplitude (coherent gain 0.5).
+ */
+
+#include "fixmath.h"
+#include "fft.h"
+
+#define FFT_GROWTH      79109UL     // 1 + sqrt(2) in Q15: worst gain of a butterfly
+#define FFT_SIN_STEP    (FIX_SIN_POINTS / FFT_MAX_POINTS)
+
+#if FIX_SIN_POINTS % FFT_MAX_POINTS
+#error "fixSin[] is too coarse for FFT_MAX_POINTS"
+#endif
+
+// Hann window 0.5 - 0.5 cos(2 pi i / FFT_MAX_POINTS) in Q15, i = 0..FFT_MAX_POINTS/2;
+// the second half mirrors the first
+static const int fftHann[FFT_MAX_POINTS / 2 + 1] = {
+    0, 0, 1, 3, 5, 8, 11, 15, 20, 25,
+    31, 37, 44, 52, 60, 69, 79, 89, 100, 111,
+    123, 136, 149, 163, 177, 192, 208, 224, 241, 259,
+    277, 296, 315, 335, 355, 376, 398, 420, 443, 467,
+    491, 516, 541, 567, 593, 621, 648, 677, 705, 735,
+    765, 796, 827, 859, 891, 924, 958, 992, 1027, 1062,
+    1098, 1134, 1171, 1209, 1247, 1286, 1325, 1365, 1406, 1447,
+    1488, 1530, 1573, 1616, 1660, 1704, 1749, 1795, 1841, 1887,
+    1935, 1982, 2030, 2079, 2128, 2178, 2229, 2280, 2331, 2383,
+    2435, 2488, 2542, 2596, 2651, 2706, 2761, 2817, 2874, 2931,
+    2989, 3047, 3105, 3165, 3224, 3284, 3345, 3406, 3468, 3530,
+    3592, 3655, 3719, 3783, 3847, 3912, 3978, 4044, 4110, 4177,
+    4244, 4312, 4380, 4449, 4518, 4587, 4657, 4728, 4799, 4870,
+    4942, 5014, 5087, 5160, 5233, 5307, 5381, 5456, 5531, 5606,
+    5682, 5759, 5835, 5913, 5990, 6068, 6146, 6225, 6304, 6383,
+    6463, 6543, 6624, 6705, 6786, 6868, 6950, 7032, 7115, 7198,
+    7282, 7365, 7449, 7534, 7619, 7704, 7789, 7875, 7961, 8047,
+    8134, 8221, 8308, 8396, 8484, 8572, 8661, 8749, 8839, 8928,
+    9018, 9108, 9198, 9288, 9379, 9470, 9561, 9653, 9745, 9837,
+    9929, 10021, 10114, 10207, 10300, 10394, 10487, 10581, 10676, 10770,
+    10864, 10959, 11054, 11149, 11245, 11340, 11436, 11532, 11628, 11724,
+    11821, 11917, 12014, 12111, 12208, 12306, 12403, 12501, 12598, 12696,
+    12794, 12892, 12991, 13089, 13188, 13286, 13385, 13484, 13583, 13682,
+    13781, 13881, 13980, 14079, 14179, 14279, 14378, 14478, 14578, 14678,
+    14778, 14878, 14978, 15078, 15179, 15279, 15379, 15480, 15580, 15680,
+    15781, 15881, 15982, 16082, 16183, 16283, 16384, 16485, 16585, 16686,
+    16786, 16887, 16987, 17088, 17188, 17288, 17389, 17489, 17589, 17690,
+    17790, 17890, 17990, 18090, 18190, 18290, 18390, 18489, 18589, 18689,
+    18788, 18887, 18987, 19086, 19185, 19284, 19383, 19482, 19580, 19679,
+    19777, 19876, 19974, 20072, 20170, 20267, 20365, 20462, 20560, 20657,
+    20754, 20851, 20947, 21044, 21140, 21236, 21332, 21428, 21523, 21619,
+    21714, 21809, 21904, 21998, 22092, 22187, 22281, 22374, 22468, 22561,
+    22654, 22747, 22839, 22931, 23023, 23115, 23207, 23298, 23389, 23480,
+    23570, 23660, 23750, 23840, 23929, 24019, 24107, 24196, 24284, 24372,
+    24460, 24547, 24634, 24721, 24807, 24893, 24979, 25064, 25149, 25234,
+    25319, 25403, 25486, 25570, 25653, 25736, 25818, 25900, 25982, 26063,
+    26144, 26225, 26305, 26385, 26464, 26543, 26622, 26700, 26778, 26855,
+    26933, 27009, 27086, 27162, 27237, 27312, 27387, 27461, 27535, 27608,
+    27681, 27754, 27826, 27898, 27969, 28040, 28111, 28181, 28250, 28319,
+    28388, 28456, 28524, 28591, 28658, 28724, 28790, 28856, 28921, 28985,
+    29049, 29113, 29176, 29238, 29300, 29362, 29423, 29484, 29544, 29603,
+    29663, 29721, 29779, 29837, 29894, 29951, 30007, 30062, 30117, 30172,
+    30226, 30280, 30333, 30385, 30437, 30488, 30539, 30590, 30640, 30689,
+    30738, 30786, 30833, 30881, 30927, 30973, 31019, 31064, 31108, 31152,
+    31195, 31238, 31280, 31321, 31362, 31403, 31443, 31482, 31521, 31559,
+    31597, 31634, 31670, 31706, 31741, 31776, 31810, 31844, 31877, 31909,
+    31941, 31972, 32003, 32033, 32063, 32091, 32120, 32147, 32175, 32201,
+    32227, 32252, 32277, 32301, 32325, 32348, 32370, 32392, 32413, 32433,
+    32453, 32472, 32491, 32509, 32527, 32544, 32560, 32576, 32591, 32605,
+    32619, 32632, 32645, 32657, 32668, 32679, 32689, 32699, 32708, 32716,
+    32724, 32731, 32737, 32743, 32748, 32753, 32757, 32760, 32763, 32765,
+    32767, 32767, 32767
+};
+
+/***************************************************************************************
+ * Function: Fft_Twiddle()                                                             *
+ * Input Parameters: i - angle 2 pi i / FFT_MAX_POINTS, 0 <= i < FFT_MAX_POINTS/2      *
+ *                   c, s - receive its cosine and sine                                *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Both come from the quarter-wave sine table fixSin[] (fixmath.c).               *
+ ***************************************************************************************/
+static void Fft_Twiddle(unsigned int i, int *c, int *s) {
+    i *= FFT_SIN_STEP;
+    if (i <= FIX_SIN_POINTS / 4) {
+        *c = fixSin[FIX_SIN_POINTS / 4 - i];
+        *s = fixSin[i];
+    } else {
+        *c = -fixSin[i - FIX_SIN_POINTS / 4];
+        *s = fixSin[FIX_SIN_POINTS / 2 - i];
+    }
+}
+
+/***************************************************************************************
+ * Function: Fft_Shift()                                                               *
+ * Input Parameters: x - values of a stage, n - how many                               *
+ * Output: right shift that keeps the stage's outputs within 16 bits                   *
+ * Description:                                                                        *
+ *      A butterfly or split output is at most 1 + sqrt(2) times the largest           *
+ *      input component, so the stage is scaled by the fewest halvings that keep       *
+ *      that below 32768. Small signals are never scaled at all.                       *
+ ***************************************************************************************/
+static unsigned int Fft_Shift(const int *x, unsigned int n) {
+    unsigned int i;
+    unsigned int peak = 0;
+    unsigned int a;
+    unsigned long grown;
+    unsigned int shift = 0;
+
+    for (i = 0; i < n; i++) {
+        a = (x[i] < 0) ? -(unsigned int) x[i] : (unsigned int) x[i];
+        if (a > peak)
+            peak = a;
+    }
+    grown = (peak * FFT_GROWTH) >> 15;
+    while (grown > 32767) {
+        grown >>= 1;
+        shift++;
+    }
+    return shift;
+}
+
+/***************************************************************************************
+ * Function: Fft_Load()                                                                *
+ * Input Parameters: x     - n ints of work buffer                                     *
+ *                   p     - ring of 12-bit samples                                    *
+ *                   first - oldest sample to take, the ring wraps at ring             *
+ *                   n     - FFT size, a power of two, FFT_MIN..FFT_MAX_POINTS         *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Copies n samples without their mean into Q15 (<< 3, so +-4095 still            *
+ *      fits) and applies the Hann window.                                             *
+ ***************************************************************************************/
+void Fft_Load(int *x, const volatile unsigned int *p, unsigned int first,
+              unsigned int ring, unsigned int n) {
+    unsigned int i, k;
+    unsigned int stride = FFT_MAX_POINTS / n;
+    unsigned long sum = 0;
+    int mean;
+
+    k = first;
+    for (i = 0; i < n; i++) {
+        x[i] = (int) p[k];
+        sum += p[k];
+        if (++k == ring)
+            k = 0;
+    }
+    mean = (int) (sum / n);
+    for (i = 0; i < n; i++)
+        x[i] = Q15_MUL((x[i] - mean) << 3, fftHann[((i <= n / 2) ? i : n - i) * stride]);
+}
+
+/***************************************************************************************
+ * Function: Fft_Real()                                                                *
+ * Input Parameters: x - n windowed Q15 samples, replaced by the spectrum              *
+ *                   n - FFT size, a power of two, FFT_MIN..FFT_MAX_POINTS             *
+ * Output: exp, the right shifts taken: the true X[k] is the result << exp             *
+ * Description:                                                                        *
+ *      The samples are taken as n/2 complex values (even samples real, odd            *
+ *      imaginary), transformed by a decimation-in-time radix-2 FFT, and split         *
+ *      into the spectrum of the real sequence:                                        *
+ *          X[k] = Fe + W^k Fo,  X[n/2-k] = conj(Fe - W^k Fo)                          *
+ *          Fe = (Z[k] + conj(Z[n/2-k])) / 2,  Fo = -j (Z[k] - conj(Z[n/2-k])) / 2     *
+ *      X[k] for k = 1..n/2-1 is left as re, im at x[2k], x[2k+1]; X[0] and            *
+ *      X[n/2], both real, are at x[0] and x[1].                                       *
+ ***************************************************************************************/
+unsigned int Fft_Real(int *x, unsigned int n) {
+    unsigned int m = n >> 1;            // complex points
+    unsigned int i, j, k, bit, len, half, stride, shift;
+    unsigned int exp = 0;
+    int c, s, t, ar, ai, br, bi;
+    int fer, fei, fr, fi;
+    long tr, ti;
+
+    // bit-reversed order, complex pairs
+    j = 0;
+    for (i = 0; i < m; i++) {
+        if (i < j) {
+            t = x[2 * i];
+            x[2 * i] = x[2 * j];
+            x[2 * j] = t;
+            t = x[2 * i + 1];
+            x[2 * i + 1] = x[2 * j + 1];
+            x[2 * j + 1] = t;
+        }
+        bit = m >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+    }
+
+    for (len = 2; len <= m; len <<= 1) {
+        shift = Fft_Shift(x, n);
+        exp += shift;
+        half = len >> 1;
+        stride = FFT_MAX_POINTS / len;
+        for (k = 0; k < half; k++) {
+            Fft_Twiddle(k * stride, &c, &s);
+            for (i = k; i < m; i += len) {
+                j = i + half;
+                br = x[2 * j];
+                bi = x[2 * j + 1];
+                // b * (c - j s), scaled with the stage
+                tr = ((long) br * c + (long) bi * s) >> (15 + shift);
+                ti = ((long) bi * c - (long) br * s) >> (15 + shift);
+                ar = x[2 * i] >> shift;
+                ai = x[2 * i + 1] >> shift;
+                x[2 * i] = ar + (int) tr;
+                x[2 * i + 1] = ai + (int) ti;
+                x[2 * j] = ar - (int) tr;
+                x[2 * j + 1] = ai - (int) ti;
+            }
+        }
+    }
+
+    shift = Fft_Shift(x, n);
+    exp += shift;
+    ar = x[0] >> shift;
+    ai = x[1] >> shift;
+    x[0] = ar + ai;                     // X[0]
+    x[1] = ar - ai;                     // X[n/2]
+    stride = FFT_MAX_POINTS / n;
+    for (k = 1; k <= m / 2; k++) {
+        j = m - k;
+        fer = (int) (((long) x[2 * k] + x[2 * j]) >> (1 + shift));
+        fei = (int) (((long) x[2 * k + 1] - x[2 * j + 1]) >> (1 + shift));
+        fr = (int) (((long) x[2 * k + 1] + x[2 * j + 1]) >> (1 + shift));
+        fi = (int) (((long) x[2 * j] - x[2 * k]) >> (1 + shift));
+        Fft_Twiddle(k * stride, &c, &s);
+        tr = ((long) fr * c + (long) fi * s) >> 15;
+        ti = ((long) fi * c - (long) fr * s) >> 15;
+        x[2 * k] = fer + (int) tr;
+        x[2 * k + 1] = fei + (int) ti;
+        x[2 * j] = fer - (int) tr;      // k = m/2 writes the same value twice
+        x[2 * j + 1] = (int) ti - fei;
+    }
+    return exp;
+}
+
+/***************************************************************************************
+ * Function: Fft_Magnitude()                                                           *
+ * Input Parameters: x - output of Fft_Real(), n - its size                            *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Replaces x[0..n/2-1] by |X[k]| as unsigned ints, bin k at k * rate / n.        *
+ *      Bin k is read from x[2k] before x[k] is written, so it works in place.         *
+ ***************************************************************************************/
+void Fft_Magnitude(int *x, unsigned int n) {
+    unsigned int k;
+    long re, im;
+
+    x[0] = (x[0] < 0) ? -x[0] : x[0];
+    for (k = 1; k < n / 2; k++) {
+        re = x[2 * k];
+        im = x[2 * k + 1];
+        x[k] = (int) Fix_Sqrt((unsigned long) (re * re + im * im));
+    }
+}
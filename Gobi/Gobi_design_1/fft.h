@@ -0,0 +1,23 @@
+/*
+ * fft.h
+ *
+ *  Magnitude spectrum of a real block in Q15. An n-point real FFT is done
+ *  as an n/2-point complex radix-2 FFT in place over the n samples plus a
+ *  split step, so the work buffer is just the n samples. Each stage is
+ *  scaled down only as far as its inputs need (block floating point), and
+ *  the shifts taken are returned so magnitudes can be scaled back.
+ *  The sine (fixmath.c) and Hann window tables are const, in FLASH.
+ */
+
+#ifndef FFT_H_
+#define FFT_H_
+
+#define FFT_MIN_POINTS      256
+#define FFT_MAX_POINTS      1024        // size of the twiddle and window tables
+
+void Fft_Load(int *x, const volatile unsigned int *p, unsigned int first,
+              unsigned int ring, unsigned int n);
+unsigned int Fft_Real(int *x, unsigned int n);
+void Fft_Magnitude(int *x, unsigned int n);
+
+#endif /* FFT_H_ */
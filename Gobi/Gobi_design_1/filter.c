@@ -0,0 +1,313 @@
+/*
+ * filter.c
+ *
+ *  Biquad and FIR engine (see filter.h).
+ *
+ *  Samples are taken around the channel's DC level into Q15 (<< 3) and
+ *  put back on the 12-bit ADC scale, clamped to 0..4095.
+ *  Biquads are direct form I with Q14 coefficients, stored as
+ *  b0, b1, b2, -a1, -a2 so one MPYS and four MACS give a section.
+ *  FIR taps are Q15, with the history written twice so the taps are
+ *  always one contiguous window.
+ *
+ *  Cost per sample and channel (FILT_BIQUAD_CYCLES, FILT_FIR_CYCLES) is
+ *  about 30 plus 100 per section, or 40 plus 13 per tap: every operand
+ *  goes through the multiplier's registers and the Q29 sum is saturated
+ *  and shifted back. These are counts from the instructions, not
+ *  measurements. Filt_Config() in main.c refuses a selection whose total,
+ *  next to the rest of the processing (Proc_Cycles), exceeds the cycles of
+ *  a sample period. The shortest Timer B period ('R') for each design with
+ *  the default skew correction, and the rate it gives at 8MHz:
+ *      design                      one channel     both channels
+ *      1-3 low-pass, 2 sections    313, 25.5k      543, 14.7k
+ *      4   high-pass, 1 section    213, 37.5k      343, 23.3k
+ *      5   31-tap FIR              526, 15.2k      969, 8.3k
+ *      6   15-tap FIR              318, 25.1k      553, 14.5k
+ *  'K 0' (no skew correction) takes 49 off each period. At the 160-cycle
+ *  default a user design of up to 2 FIR taps fits on one channel, 6 with
+ *  'K 0'.
+ */
+
+#include <msp430.h>
+#include "filter.h"
+
+struct FiltDesign {
+    unsigned int type;
+    unsigned int len;                   // sections or taps
+    const int *coef;
+};
+
+// 4th-order Butterworth low-pass as two sections (Q 0.541 and 1.307), cutoff fs/8
+static const int filtLp8[] = {
+    1451, 2903, 1451, 14015, -3436,
+    1888, 3777, 1888, 18236, -9405
+};
+
+// the same with cutoff fs/16
+static const int filtLp16[] = {
+    461, 921, 461, 22366, -7825,
+    544, 1088, 544, 26407, -12198
+};
+
+// the same with cutoff fs/32
+static const int filtLp32[] = {
+    133, 267, 133, 27230, -11380,
+    146, 293, 146, 29906, -14108
+};
+
+// 2nd-order Butterworth high-pass, cutoff fs/256: takes out drift and hum below it
+static const int filtHp256[] = {
+    16102, -32204, 16102, 32199, -15825
+};
+
+// 31-tap low-pass, cutoff fs/8, Hamming window: linear phase, 15 samples delay
+static const int filtFir8[] = {
+    -39, -67, -68, 0, 156, 324, 327, 0, -621, -1189, -1139, 0, 2249, 5022, 7322, 8213,
+    7322, 5022, 2249, 0, -1139, -1189, -621, 0, 327, 324, 156, 0, -68, -67, -39
+};
+
+// 15-tap half-band low-pass, cutoff fs/4, Hamming window: 7 samples delay
+static const int filtFir4[] = {
+    -120, 0, 530, 0, -2242, 0, 9993, 16445, 9993, 0, -2242, 0, 530, 0, -120
+};
+
+static const struct FiltDesign filtDesigns[FILT_USER] = {
+    { FILT_OFF, 0, 0 },
+    { FILT_BIQUAD, 2, filtLp8 },        // 1
+    { FILT_BIQUAD, 2, filtLp16 },       // 2
+    { FILT_BIQUAD, 2, filtLp32 },       // 3
+    { FILT_BIQUAD, 1, filtHp256 },      // 4
+    { FILT_FIR, 31, filtFir8 },         // 5
+    { FILT_FIR, 15, filtFir4 }          // 6
+};
+
+static int filtUserCoef[FILT_USER_COEFS];
+static struct FiltDesign filtUser = { FILT_OFF, 0, filtUserCoef };     // FILT_USER
+
+static int *filtMem;                    // FILT_WORDS per channel
+static unsigned int filtDesign[FILT_CHANNELS];
+static unsigned int filtPos[FILT_CHANNELS];    // newest FIR sample is at history[pos]
+
+static const struct FiltDesign *Filt_Get(unsigned int design) {
+    return (design == FILT_USER) ? &filtUser : &filtDesigns[design];
+}
+
+/***************************************************************************************
+ * Function: Filt_Init()                                                               *
+ * Input Parameters: mem - FILT_BYTES of word-aligned RAM for the filter state         *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Starts with every channel unfiltered.                                          *
+ ***************************************************************************************/
+void Filt_Init(int *mem) {
+    unsigned int ch;
+
+    filtMem = mem;
+    for (ch = 0; ch < FILT_CHANNELS; ch++)
+        filtDesign[ch] = FILT_OFF;
+    Filt_Restart();
+}
+
+/***************************************************************************************
+ * Function: Filt_Select()                                                             *
+ * Input Parameters: ch     - channel, 0 = A2, 1 = A1                                  *
+ *                   design - index into filtDesigns[] or FILT_USER, 0 = off           *
+ * Output: 0, or -1 if either is out of range or the user design is empty              *
+ * Description:                                                                        *
+ *      The channel's state is cleared by the next Filt_Restart().                     *
+ ***************************************************************************************/
+int Filt_Select(unsigned int ch, unsigned int design) {
+    if (ch >= FILT_CHANNELS || design > FILT_USER
+        || (design == FILT_USER && filtUser.type == FILT_OFF))
+        return -1;
+    filtDesign[ch] = design;
+    return 0;
+}
+
+/***************************************************************************************
+ * Function: Filt_Design()                                                             *
+ * Input Parameters: ch - channel                                                      *
+ * Output: the design it runs, 0 = off                                                 *
+ ***************************************************************************************/
+unsigned int Filt_Design(unsigned int ch) {
+    return filtDesign[ch];
+}
+
+/***************************************************************************************
+ * Function: Filt_Cycles()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: estimated MCLK cycles per sample of both channels' designs                  *
+ ***************************************************************************************/
+unsigned int Filt_Cycles(void) {
+    const struct FiltDesign *d;
+    unsigned int ch;
+    unsigned int cycles = 0;
+
+    for (ch = 0; ch < FILT_CHANNELS; ch++) {
+        d = Filt_Get(filtDesign[ch]);
+        if (d->type == FILT_BIQUAD)
+            cycles += FILT_BIQUAD_CYCLES(d->len);
+        else if (d->type == FILT_FIR)
+            cycles += FILT_FIR_CYCLES(d->len);
+    }
+    return cycles;
+}
+
+/***************************************************************************************
+ * Function: Filt_User()                                                               *
+ * Input Parameters: type - FILT_BIQUAD, FILT_FIR or FILT_OFF to clear it              *
+ *                   len  - sections (1..FILT_USER_COEFS/5) or taps                    *
+ *                          (1..FILT_USER_COEFS)                                       *
+ * Output: 0, or -1 if the shape is invalid or a channel runs the user design          *
+ * Description:                                                                        *
+ *      Shapes the user design and zeroes its coefficients, which are then             *
+ *      loaded with Filt_Coef(): Q14 b0, b1, b2, -a1, -a2 per section, or Q15          *
+ *      taps, newest sample's first.                                                   *
+ ***************************************************************************************/
+int Filt_User(unsigned int type, unsigned int len) {
+    unsigned int max = 0;
+    unsigned int k;
+
+    if (type == FILT_BIQUAD)
+        max = FILT_USER_COEFS / 5;
+    else if (type == FILT_FIR)
+        max = FILT_USER_COEFS;
+    else if (type != FILT_OFF)
+        return -1;
+    if ((max && (len == 0 || len > max))
+        || filtDesign[0] == FILT_USER || filtDesign[1] == FILT_USER)
+        return -1;
+    filtUser.type = type;
+    filtUser.len = (type == FILT_OFF) ? 0 : len;
+    for (k = 0; k < FILT_USER_COEFS; k++)
+        filtUserCoef[k] = 0;
+    return 0;
+}
+
+/***************************************************************************************
+ * Function: Filt_Coef()                                                               *
+ * Input Parameters: k - coefficient of the user design                                *
+ *                   c - its value                                                     *
+ * Output: 0, or -1 if k is beyond the design                                          *
+ * Description:                                                                        *
+ *      Takes effect at once, also on a channel that runs the user design.             *
+ ***************************************************************************************/
+int Filt_Coef(unsigned int k, int c) {
+    if (k >= ((filtUser.type == FILT_BIQUAD) ? 5 * filtUser.len : filtUser.len))
+        return -1;
+    filtUserCoef[k] = c;
+    return 0;
+}
+
+/***************************************************************************************
+ * Function: Filt_UserType() / Filt_UserLen()                                          *
+ * Output: type and sections or taps of the user design                                *
+ ***************************************************************************************/
+unsigned int Filt_UserType(void) {
+    return filtUser.type;
+}
+
+unsigned int Filt_UserLen(void) {
+    return filtUser.len;
+}
+
+/***************************************************************************************
+ * Function: Filt_Restart()                                                            *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Clears all state after a gap in the input, as if the input had been at         *
+ *      its DC level before.                                                           *
+ ***************************************************************************************/
+void Filt_Restart(void) {
+    unsigned int k;
+
+    for (k = 0; k < FILT_CHANNELS * FILT_WORDS; k++)
+        filtMem[k] = 0;
+    for (k = 0; k < FILT_CHANNELS; k++)
+        filtPos[k] = 0;
+}
+
+/***************************************************************************************
+ * Function: Filt_Block()                                                              *
+ * Input Parameters: ch    - channel                                                   *
+ *                   p     - its block, filtered in place                              *
+ *                   count - samples                                                   *
+ *                   mid   - DC level of the channel                                   *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Runs the channel's design over one block. Results beyond 16 bits               *
+ *      saturate instead of wrapping.                                                  *
+ ***************************************************************************************/
+void Filt_Block(unsigned int ch, volatile unsigned int *p, unsigned int count,
+                unsigned int mid) {
+    const struct FiltDesign *d = Filt_Get(filtDesign[ch]);
+    int *state = filtMem + ch * FILT_WORDS;
+    unsigned int taps = d->len;
+    unsigned int pos = filtPos[ch];
+    const int *c;
+    int *s, *h;
+    unsigned int i, k;
+    int x, hi, out;
+
+    if (d->type == FILT_OFF)
+        return;
+
+    for (i = 0; i < count; i++) {
+        x = (int) (p[i] - mid) << 3;
+
+        if (d->type == FILT_BIQUAD) {
+            c = d->coef;
+            s = state;                  // x1, x2, y1, y2 per section
+            for (k = 0; k < d->len; k++) {
+                MPYS = c[0];
+                OP2 = x;
+                MACS = c[1];
+                OP2 = s[0];
+                MACS = c[2];
+                OP2 = s[1];
+                MACS = c[3];
+                OP2 = s[2];
+                MACS = c[4];
+                OP2 = s[3];
+                s[1] = s[0];
+                s[0] = x;
+                hi = (int) RESHI;       // Q29 sum, Q15 result
+                if (hi >= 0x2000)
+                    x = 32767;
+                else if (hi < -0x2000)
+                    x = -32768;
+                else
+                    x = (int) ((hi << 2) | (RESLO >> 14));
+                s[3] = s[2];
+                s[2] = x;
+                c += 5;
+                s += 4;
+            }
+        } else {
+            // newest first; the second copy keeps the window contiguous
+            h = state + pos;
+            h[0] = x;
+            h[taps] = x;
+            c = d->coef;
+            MPYS = c[0];
+            OP2 = h[0];
+            for (k = 1; k < taps; k++) {
+                MACS = c[k];
+                OP2 = h[k];
+            }
+            hi = (int) RESHI;           // Q30 sum, Q15 result
+            if (hi >= 0x4000)
+                x = 32767;
+            else if (hi < -0x4000)
+                x = -32768;
+            else
+                x = (int) ((hi << 1) | (RESLO >> 15));
+            pos = pos ? pos - 1 : taps - 1;
+        }
+
+        out = (x >> 3) + (int) mid;
+        p[i] = (out < 0) ? 0 : (out > 4095 ? 4095 : out);
+    }
+    filtPos[ch] = pos;
+}
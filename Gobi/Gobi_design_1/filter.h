@@ -0,0 +1,45 @@
+/*
+ * filter.h
+ *
+ *  Per-channel Q15 filters run in place on each captured block before the
+ *  channels are combined. A channel runs either a cascade of biquads or an
+ *  FIR, picked by number from the designs in filter.c, which are const
+ *  (FLASH), or the user design FILT_USER, whose coefficients are loaded at
+ *  run time. Cutoffs are fractions of the sample rate. The state is kept across
+ *  blocks, so a block boundary is invisible in the output. Products go
+ *  through the 16x16 hardware multiplier, which must not be used by
+ *  interrupt routines meanwhile.
+ */
+
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#define FILT_CHANNELS       2           // A2 (buffer0) and A1 (buffer1)
+#define FILT_MAX_SECTIONS   4
+#define FILT_MAX_TAPS       32
+#define FILT_WORDS          (2 * FILT_MAX_TAPS)     // state per channel
+#define FILT_BYTES          (FILT_CHANNELS * FILT_WORDS * sizeof(int))
+
+#define FILT_OFF            0           // design types
+#define FILT_BIQUAD         1
+#define FILT_FIR            2
+#define FILT_USER           7           // design number of the loaded coefficients
+#define FILT_USER_COEFS     10          // two biquad sections or ten FIR taps
+
+// estimated MCLK cycles per sample and channel, counted from the instructions
+#define FILT_BIQUAD_CYCLES(sections)    (30 + 100 * (sections))
+#define FILT_FIR_CYCLES(taps)           (40 + 13 * (taps))
+
+void Filt_Init(int *mem);
+int Filt_Select(unsigned int ch, unsigned int design);
+unsigned int Filt_Design(unsigned int ch);
+unsigned int Filt_Cycles(void);
+int Filt_User(unsigned int type, unsigned int len);
+int Filt_Coef(unsigned int k, int c);
+unsigned int Filt_UserType(void);
+unsigned int Filt_UserLen(void);
+void Filt_Restart(void);
+void Filt_Block(unsigned int ch, volatile unsigned int *p, unsigned int count,
+                unsigned int mid);
+
+#endif /* FILTER_H_ */
@@ -0,0 +1,308 @@
+/*
+ * fixmath.c
+ *
+ *  Fixed-point helpers that are too long to be macros (see fixmath.h).
+ */
+
+#include "fixmath.h"
+#include "kernel.h"
+
+// sin(2 pi i / FIX_SIN_POINTS) in Q15, i = 0..FIX_SIN_POINTS/4
+const int fixSin[FIX_SIN_POINTS / 4 + 1] = {
+    0, 201, 402, 603, 804, 1005, 1206, 1407, 1608, 1809,
+    2009, 2210, 2411, 2611, 2811, 3012, 3212, 3412, 3612, 3812,
+    4011, 4211, 4410, 4609, 4808, 5007, 5205, 5404, 5602, 5800,
+    5998, 6195, 6393, 6590, 6787, 6983, 7180, 7376, 7571, 7767,
+    7962, 8157, 8351, 8546, 8740, 8933, 9127, 9319, 9512, 9704,
+    9896, 10088, 10279, 10469, 10660, 10850, 11039, 11228, 11417, 11605,
+    11793, 11980, 12167, 12354, 12540, 12725, 12910, 13095, 13279, 13463,
+    13646, 13828, 14010, 14192, 14373, 14553, 14733, 14912, 15091, 15269,
+    15447, 15624, 15800, 15976, 16151, 16326, 16500, 16673, 16846, 17018,
+    17190, 17361, 17531, 17700, 17869, 18037, 18205, 18372, 18538, 18703,
+    18868, 19032, 19195, 19358, 19520, 19681, 19841, 20001, 20160, 20318,
+    20475, 20632, 20788, 20943, 21097, 21251, 21403, 21555, 21706, 21856,
+    22006, 22154, 22302, 22449, 22595, 22740, 22884, 23028, 23170, 23312,
+    23453, 23593, 23732, 23870, 24008, 24144, 24279, 24414, 24548, 24680,
+    24812, 24943, 25073, 25202, 25330, 25457, 25583, 25708, 25833, 25956,
+    26078, 26199, 26320, 26439, 26557, 26674, 26791, 26906, 27020, 27133,
+    27246, 27357, 27467, 27576, 27684, 27791, 27897, 28002, 28106, 28209,
+    28311, 28411, 28511, 28610, 28707, 28803, 28899, 28993, 29086, 29178,
+    29269, 29359, 29448, 29535, 29622, 29707, 29792, 29875, 29957, 30038,
+    30118, 30196, 30274, 30350, 30425, 30499, 30572, 30644, 30715, 30784,
+    30853, 30920, 30986, 31050, 31114, 31177, 31238, 31298, 31357, 31415,
+    31471, 31527, 31581, 31634, 31686, 31737, 31786, 31834, 31881, 31927,
+    31972, 32015, 32058, 32099, 32138, 32177, 32214, 32251, 32286, 32319,
+    32352, 32383, 32413, 32442, 32470, 32496, 32522, 32546, 32568, 32590,
+    32610, 32629, 32647, 32664, 32679, 32693, 32706, 32718, 32729, 32738,
+    32746, 32753, 32758, 32762, 32766, 32767, 32767
+};
+
+// log2(1 + i/32) in Q15, 32768 = one octave, i = 0..32
+static const unsigned int fixLog2[33] = {
+    0, 1455, 2866, 4236, 5568, 6863, 8124, 9352, 10549, 11716,
+    12855, 13968, 15055, 16117, 17156, 18173, 19168, 20143, 21098, 22034,
+    22952, 23852, 24736, 25604, 26455, 27292, 28114, 28922, 29717, 30498,
+    31267, 32024, 32768
+};
+
+// 2^31 / (32768 + 1024 i) - 32768, i = 0..32: seeds for Fix_Recip()
+static const unsigned int fixRecip[33] = {
+    32768, 30782, 28913, 27151, 25486, 23912, 22420, 21005, 19661, 18382,
+    17164, 16003, 14895, 13835, 12822, 11852, 10923, 10031, 9175, 8353,
+    7562, 6801, 6068, 5362, 4681, 4024, 3390, 2777, 2185, 1612,
+    1057, 520, 0
+};
+
+// atan(2^-i) as a binary angle, i = 0..FIX_ATAN_STEPS-1
+static const int fixAtan[FIX_ATAN_STEPS] = {
+    8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1, 1
+};
+
+/***************************************************************************************
+ * Function: Fix_Sqrt()                                                                *
+ * Input Parameters: x - radicand                                                      *
+ * Output: floor(sqrt(x))                                                              *
+ * Description:                                                                        *
+ *      Bit-by-bit square root, one result bit per pass and no multiplies or           *
+ *      divides. 16 passes of 32-bit adds, compares and shifts, about 450 cycles.      *
+ *      Exact.                                                                         *
+ ***************************************************************************************/
+unsigned int Fix_Sqrt(unsigned long x) {
+    unsigned long root = 0;
+    unsigned long bit = 1UL << 30;      // highest power of 4 in 32 bits
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (unsigned int) root;
+}
+
+/***************************************************************************************
+ * Function: Fix_Sin()                                                                 *
+ * Input Parameters: angle - binary angle, 65536 per turn                              *
+ * Output: sine in Q15                                                                 *
+ * Description:                                                                        *
+ *      Linear interpolation in fixSin[]. The table steps are 1/1024 turn, so the      *
+ *      result is within 1 LSB. One 16x16 multiply, about 50 cycles.                   *
+ ***************************************************************************************/
+int Fix_Sin(unsigned int angle) {
+    unsigned int step = angle >> 6;                 // 1/1024 turn
+    unsigned int i = step & (FIX_SIN_POINTS / 4 - 1);
+    int frac = angle & 63;
+    int a, b;
+
+    if (step & (FIX_SIN_POINTS / 4)) {              // second and fourth quarter
+        a = fixSin[FIX_SIN_POINTS / 4 - i];
+        b = fixSin[FIX_SIN_POINTS / 4 - 1 - i];
+    } else {
+        a = fixSin[i];
+        b = fixSin[i + 1];
+    }
+    a += ((b - a) * frac + 32) >> 6;
+    return (step & (FIX_SIN_POINTS / 2)) ? -a : a;
+}
+
+/***************************************************************************************
+ * Function: Fix_Cos()                                                                 *
+ * Input Parameters: angle - binary angle, 65536 per turn                              *
+ * Output: cosine in Q15                                                               *
+ * Description:                                                                        *
+ *      Fix_Sin() a quarter turn on.                                                   *
+ ***************************************************************************************/
+int Fix_Cos(unsigned int angle) {
+    return Fix_Sin(angle + 16384);
+}
+
+/***************************************************************************************
+ * Function: Fix_Atan2()                                                               *
+ * Input Parameters: y, x - vector                                                     *
+ * Output: its angle as a signed binary angle, -32768..32767 for -pi..pi               *
+ * Description:                                                                        *
+ *      CORDIC vectoring: the vector is turned onto the x axis by FIX_ATAN_STEPS       *
+ *      shift-and-add rotations and the angles turned through are summed. The          *
+ *      left half-plane is turned by pi first. Error within 4 binary-angle units       *
+ *      (0.02 degrees) for vectors longer than a few hundred; no multiplies. The       *
+ *      32-bit shifts by i dominate: about 1400 cycles.                                *
+ ***************************************************************************************/
+int Fix_Atan2(int y, int x) {
+    long xl = (long) x << 14;           // room below the point for the shifts
+    long yl = (long) y << 14;
+    long t;
+    unsigned int z = 0;
+    unsigned int i;
+
+    if (xl < 0) {
+        xl = -xl;
+        yl = -yl;
+        z = 32768U;
+    }
+    for (i = 0; i < FIX_ATAN_STEPS; i++) {
+        t = xl;
+        if (yl > 0) {
+            xl += yl >> i;
+            yl -= t >> i;
+            z += fixAtan[i];
+        } else {
+            xl -= yl >> i;
+            yl += t >> i;
+            z -= fixAtan[i];
+        }
+    }
+    return (int) z;
+}
+
+/***************************************************************************************
+ * Function: Fix_MulQ15()                                                              *
+ * Input Parameters: a, b - Q15 factors                                                *
+ * Output: a * b in Q15, rounded, saturated                                            *
+ * Description:                                                                        *
+ *      Within 0.5 LSB. Only -1 * -1 saturates, to Q15_ONE. One MPYS, about 25         *
+ *      cycles. Q15_MUL() is cheaper where truncation and wrapping are harmless.       *
+ ***************************************************************************************/
+int Fix_MulQ15(int a, int b) {
+    long p = ((long) a * b + 0x4000) >> 15;
+
+    return (p > Q15_ONE) ? Q15_ONE : (int) p;
+}
+
+/***************************************************************************************
+ * Function: Fix_MulQ31()                                                              *
+ * Input Parameters: a, b - Q31 factors                                                *
+ * Output: a * b in Q31, saturated                                                     *
+ * Description:                                                                        *
+ *      From the three 16x16 partial products that reach bit 31: hi * hi and the       *
+ *      two hi * lo, with lo halved so MPYS can take it as signed. The low * low       *
+ *      product and the dropped bits leave the result within 6 LSB (3e-9). Only        *
+ *      -1 * -1 saturates, to Q31_ONE. Three MPYS, about 120 cycles.                   *
+ ***************************************************************************************/
+long Fix_MulQ31(long a, long b) {
+    int ah = (int) (a >> 16);
+    int bh = (int) (b >> 16);
+    int al = (int) ((unsigned int) a >> 1);
+    int bl = (int) ((unsigned int) b >> 1);
+    unsigned long r;
+
+    if (a == -Q31_ONE - 1 && b == -Q31_ONE - 1)
+        return Q31_ONE;
+    // hi * hi alone may pass 2^31 when the sum does not, so add unsigned
+    r = (unsigned long) ((long) ah * bh) << 1;
+    r += ((long) ah * bl) >> 14;
+    r += ((long) bh * al) >> 14;
+    return (long) r;
+}
+
+/***************************************************************************************
+ * Function: Fix_MacQ15()                                                              *
+ * Input Parameters: acc  - Q30 sum                                                    *
+ *                   a, b - Q15 factors                                                *
+ * Output: acc + a * b in Q30, saturated to 32 bits                                    *
+ * Description:                                                                        *
+ *      Exact unless it saturates. One MPYS, about 40 cycles; for a run of             *
+ *      products Fix_DotQ15() keeps the sum in the multiplier instead.                 *
+ ***************************************************************************************/
+long Fix_MacQ15(long acc, int a, int b) {
+    long p = (long) a * b;
+    long s = (long) ((unsigned long) acc + p);
+
+    if ((acc ^ p) >= 0 && (s ^ acc) < 0)    // both signs alike and the sum flipped
+        return (acc < 0) ? -Q31_ONE - 1 : Q31_ONE;
+    return s;
+}
+
+/***************************************************************************************
+ * Function: Fix_DotQ15()                                                              *
+ * Input Parameters: a, b - Q15 vectors                                                *
+ *                   n    - their length                                               *
+ * Output: sum of a[i] * b[i] in Q30, saturated to 32 bits                             *
+ * Description:                                                                        *
+ *      Krn_Mac() from zero: MACS in RESHI:RESLO with a wrap check after every         *
+ *      product. Exact unless it saturates; about 18 cycles per product.               *
+ ***************************************************************************************/
+long Fix_DotQ15(const int *a, const int *b, unsigned int n) {
+    return Krn_Mac(0, a, b, n);
+}
+
+/***************************************************************************************
+ * Function: Fix_Log2()                                                                *
+ * Input Parameters: x - argument                                                      *
+ * Output: log2(x) in Q(FIX_LOG2_FRAC), FIX_LOG2_ZERO for x = 0                        *
+ * Description:                                                                        *
+ *      x is normalized to 1.m and log2(1.m) interpolated in fixLog2[]. The            *
+ *      32 table steps keep the interpolation within 0.2 LSB, so the result is         *
+ *      within 1 LSB (0.001 octave, 0.006 dB). About 150 cycles.                       *
+ ***************************************************************************************/
+int Fix_Log2(unsigned long x) {
+    int e = 31;
+    unsigned int m, i, a;
+    long r;
+
+    if (x == 0)
+        return FIX_LOG2_ZERO;
+    if (!(x & 0xFFFF0000UL)) {
+        x <<= 16;
+        e -= 16;
+    }
+    if (!(x & 0xFF000000UL)) {
+        x <<= 8;
+        e -= 8;
+    }
+    while (!(x & 0x80000000UL)) {
+        x <<= 1;
+        e--;
+    }
+    m = (unsigned int) (x >> 16);   // 1.m with the point below bit 15
+    i = (m >> 10) & 31;
+    a = fixLog2[i];
+    a += (unsigned int) (((unsigned long) (fixLog2[i + 1] - a) * (m & 1023) + 512) >> 10);
+    a = (a + (1 << (14 - FIX_LOG2_FRAC))) >> (15 - FIX_LOG2_FRAC);     // rounded
+    r = ((long) e << FIX_LOG2_FRAC) + a;
+    return (r > 32767) ? 32767 : (int) r;
+}
+
+/***************************************************************************************
+ * Function: Fix_Recip()                                                               *
+ * Input Parameters: x - divisor                                                       *
+ * Output: r, with 1/x = r / 2^shift and r in 32768..65535                             *
+ *         shift - 16..31                                                              *
+ * Description:                                                                        *
+ *      For dividing many values by the same x: y / x = (y * r) >> shift is one        *
+ *      16x16 multiply instead of a 32/16 software divide (about 500 cycles).          *
+ *      The seed is interpolated in fixRecip[], good to 9 bits, and one Newton         *
+ *      step r += r * (1 - x * r) brings it within 1.1 LSB of 2^shift / x. About       *
+ *      120 cycles. x = 0 gives 65535 with shift 0.                                    *
+ ***************************************************************************************/
+unsigned int Fix_Recip(unsigned int x, unsigned int *shift) {
+    unsigned int s = 31;
+    unsigned int i, r;
+    long e, t;
+
+    if (x == 0) {
+        *shift = 0;
+        return 0xFFFF;
+    }
+    while (!(x & 0x8000)) {
+        x <<= 1;
+        s--;
+    }
+    if (x == 0x8000) {              // a power of two: 2^31 / x would be 65536
+        *shift = s - 1;
+        return 0x8000;
+    }
+    *shift = s;
+
+    // 2^31 / x, x now 32769..65535; the sum wraps through 65536 for i = 0
+    i = (x >> 10) & 31;
+    r = fixRecip[i] - fixRecip[i + 1];
+    r = 32768U + fixRecip[i] - (unsigned int) (((unsigned long) r * (x & 1023)) >> 10);
+    e = (long) (0x80000000UL - (unsigned long) x * r);
+    t = (long) r + (((long) (int) (e >> 8) * (int) (r >> 1)) >> 22);
+    return (t > 0xFFFF) ? 0xFFFF : (unsigned int) t;
+}
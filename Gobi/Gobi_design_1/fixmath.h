@@ -0,0 +1,40 @@
+/*
+ * fixmath.h
+ *
+ *  Fixed-point helpers for the signal processing code. Q15 values are
+ *  signed 16-bit fractions, 0x7FFF = 0.99997, 0x8000 = -1.0, and Q31 the
+ *  same in 32 bits. Products go through the 16x16 hardware multiplier
+ *  (--use_hw_mpy=16), so none of this may be called from an interrupt
+ *  routine while the main loop multiplies. Each function states its cycle
+ *  cost at 16MHz and its error.
+ */
+
+#ifndef FIXMATH_H_
+#define FIXMATH_H_
+
+#define Q15_ONE             32767
+#define Q31_ONE             0x7FFFFFFFL
+
+// a * b >> 15, truncated towards minus infinity
+#define Q15_MUL(a, b)       ((int) (((long) (a) * (b)) >> 15))
+
+#define FIX_SIN_POINTS      1024        // fixSin[] steps per turn, a quarter is stored
+#define FIX_ATAN_STEPS      15          // CORDIC rotations in Fix_Atan2()
+#define FIX_LOG2_FRAC       10          // Fix_Log2() results in 1/1024 octave
+#define FIX_LOG2_ZERO       (-32767 - 1)    // Fix_Log2(0)
+
+// Angles are binary: 65536 per turn, so they wrap like unsigned ints
+extern const int fixSin[FIX_SIN_POINTS / 4 + 1];
+
+unsigned int Fix_Sqrt(unsigned long x);
+int Fix_Sin(unsigned int angle);
+int Fix_Cos(unsigned int angle);
+int Fix_Atan2(int y, int x);
+int Fix_MulQ15(int a, int b);
+long Fix_MulQ31(long a, long b);
+long Fix_MacQ15(long acc, int a, int b);
+long Fix_DotQ15(const int *a, const int *b, unsigned int n);
+int Fix_Log2(unsigned long x);
+unsigned int Fix_Recip(unsigned int x, unsigned int *shift);
+
+#endif /* FIXMATH_H_ */
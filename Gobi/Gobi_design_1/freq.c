@@ -0,0 +1,171 @@
+/*
+ * freq.c
+ *
+ *  Zero-crossing frequency estimator (see freq.h).
+ *
+ *  Per sample: one load and two or three compares, about 12 cycles. Each
+ *  crossing costs one 32-bit divide for the interpolation and the result
+ *  four, so the whole estimate stays well under Data_Process().
+ *  The frequency is periods * rate / (samples spanned), in
+ *  centi-Hz, and the confidence is the shortest period over the longest
+ *  in percent: 100 for a clean tone, low when crossings were missed or
+ *  the signal is not periodic.
+ */
+
+#include "gfa.h"
+#include "freq.h"
+
+#if SYSCLK / ADCRATE_MIN > 167000UL
+#error "FREQ_SCALE does not fit 32 bits"
+#endif
+#define FREQ_SCALE(rate) (((rate) * 100UL) << FREQ_FRAC)    // centi-Hz x period
+#define FREQ_NONE       (-1L)       // no crossing to measure the next period from
+
+static int freqMid;
+static int freqLo;                  // mid - hyst, arms the next crossing
+static int freqHi;                  // mid + hyst, confirms it
+static unsigned int freqRing;       // samples in the ring Freq_Block() is fed from
+static unsigned int freqNext;       // index expected next, anything else is a gap
+static int freqPrev;                // sample before freqNext
+static int freqArmed = 0;           // below freqLo since the last crossing
+static long freqCand;               // latest upward mid crossing, Q(FREQ_FRAC)
+static long freqLast;               // last confirmed crossing, or FREQ_NONE
+static unsigned int freqPeriods;    // periods measured since Freq_Result()
+static unsigned long freqSum;       // their total length
+static unsigned long freqMin;
+static unsigned long freqMax;
+
+/***************************************************************************************
+ * Function: Freq_Start()                                                              *
+ * Input Parameters: mid  - level whose crossings are timed (the DC level)             *
+ *                   hyst - distance below and above mid a crossing must span          *
+ *                   ring - samples in the ring the blocks come from                   *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Forgets all crossings. The first block is treated as following a gap.          *
+ ***************************************************************************************/
+void Freq_Start(int mid, int hyst, unsigned int ring) {
+    unsigned int confidence;
+
+    freqMid = mid;
+    freqLo = mid - hyst;
+    freqHi = mid + hyst;
+    freqRing = ring;
+    freqNext = 0xFFFF;
+    Freq_Result(0, &confidence);    // clears the period sums
+}
+
+/***************************************************************************************
+ * Function: Freq_Block()                                                              *
+ * Input Parameters: p            - ring of samples                                    *
+ *                   first, count - block to add, first + count <= ring                *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Times the crossings in one block. A block that does not continue the           *
+ *      previous one (DMA lapped the processing) drops the crossing that was           *
+ *      waiting for its period, so no period ever spans a gap. Continuing from         *
+ *      the end of the ring to index 0 moves the crossings back by one ring, so        *
+ *      positions stay relative to the current pass over the ring.                     *
+ ***************************************************************************************/
+void Freq_Block(const volatile unsigned int *p, unsigned int first, unsigned int count) {
+    unsigned int i;
+    unsigned int last = first + count;
+    int v;
+    int prev = freqPrev;
+    unsigned long period;
+
+    if (first != freqNext) {
+        freqLast = FREQ_NONE;
+        freqArmed = 0;
+        prev = (int) p[first];
+    } else if (first == 0) {
+        freqCand -= (long) freqRing << FREQ_FRAC;
+        if (freqLast != FREQ_NONE)
+            freqLast -= (long) freqRing << FREQ_FRAC;
+    }
+
+    for (i = first; i < last; i++) {
+        v = (int) p[i];
+        if (freqArmed) {
+            if (v >= freqMid && prev < freqMid) {
+                // between samples i-1 and i, (v - mid) / (v - prev) before i
+                freqCand = ((long) i << FREQ_FRAC)
+                           - (((long) (v - freqMid) << FREQ_FRAC) / (v - prev));
+            }
+            if (v >= freqHi) {
+                if (freqLast != FREQ_NONE) {
+                    period = freqCand - freqLast;
+                    freqSum += period;
+                    freqPeriods++;
+                    if (period < freqMin)
+                        freqMin = period;
+                    if (period > freqMax)
+                        freqMax = period;
+                }
+                freqLast = freqCand;
+                freqArmed = 0;
+            }
+        } else if (v <= freqLo) {
+            freqArmed = 1;
+        }
+        prev = v;
+    }
+    freqPrev = prev;
+    freqNext = (last >= freqRing) ? 0 : last;
+}
+
+/***************************************************************************************
+ * Function: Freq_Result()                                                             *
+ * Input Parameters: rate       - samples per second                                   *
+ *                   confidence - receives 0..100, 0 with fewer than two periods       *
+ * Output: frequency in centi-Hz, 0 if no whole period was seen                        *
+ * Description:                                                                        *
+ *      Evaluates the periods measured since the last call and starts over;            *
+ *      the crossing state is kept so the next period may start in this block.         *
+ ***************************************************************************************/
+unsigned long Freq_Result(unsigned long rate, unsigned int *confidence) {
+    unsigned long scale = FREQ_SCALE(rate);
+    unsigned long f = 0;
+
+    *confidence = 0;
+    if (freqPeriods) {
+        // periods * scale / freqSum without overflowing 32 bits
+        f = freqPeriods * (scale / freqSum) + freqPeriods * (scale % freqSum) / freqSum;
+        if (freqPeriods > 1)
+            *confidence = (unsigned int) (freqMin * 100 / freqMax);
+    }
+    freqPeriods = 0;
+    freqSum = 0;
+    freqMin = 0xFFFFFFFF;
+    freqMax = 0;
+    return f;
+}
+
+/***************************************************************************************
+ * Function: Freq_Periods()                                                            *
+ * Input Parameters: NONE                                                              *
+ * Output: periods measured since the last Freq_Result()                               *
+ * Description:                                                                        *
+ *      Lets the caller wait for enough periods before evaluating a slow signal.       *
+ ***************************************************************************************/
+unsigned int Freq_Periods(void) {
+    return freqPeriods;
+}
+
+/***************************************************************************************
+ * Function: freqCalc()                                                                *
+ * Input Parameters: voltage    - samples, oldest first                                *
+ *                   count      - number of samples                                    *
+ *                   mid, hyst  - see Freq_Start()                                     *
+ *                   rate, confidence - see Freq_Result()                              *
+ * Output: frequency in centi-Hz                                                       *
+ * Description:                                                                        *
+ *      One pass over an array. Shares its state with Freq_Block(), so it must         *
+ *      not run while a block-by-block estimate is in progress.                        *
+ ***************************************************************************************/
+unsigned long freqCalc(const volatile unsigned int *voltage, unsigned int count, int mid,
+                       int hyst, unsigned long rate, unsigned int *confidence) {
+    Freq_Start(mid, hyst, count);
+    Freq_Block(voltage, 0, count);
+    return Freq_Result(rate, confidence);
+}
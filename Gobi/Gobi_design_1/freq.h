@@ -0,0 +1,22 @@
+/*
+ * freq.h
+ *
+ *  Frequency of one channel from its upward crossings of a mid level, in
+ *  fixed point. A crossing only counts once the signal has been below
+ *  mid - hyst and then reaches mid + hyst, so noise near mid cannot add
+ *  crossings. Its position is interpolated between the two samples around
+ *  mid, in Q(FREQ_FRAC) samples. Blocks can be fed one at a time
+ *  (Freq_Block) from a ring; freqCalc() in gfa.h does a whole array.
+ */
+
+#ifndef FREQ_H_
+#define FREQ_H_
+
+#define FREQ_FRAC           8       // crossing positions in 1/256 sample
+
+void Freq_Start(int mid, int hyst, unsigned int ring);
+void Freq_Block(const volatile unsigned int *p, unsigned int first, unsigned int count);
+unsigned long Freq_Result(unsigned long rate, unsigned int *confidence);
+unsigned int Freq_Periods(void);
+
+#endif /* FREQ_H_ */
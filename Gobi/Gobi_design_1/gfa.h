@@ -16,7 +16,6 @@
 #include <msp430f2618.h>
 #include "stdlib.h"
 #include "stdio.h"
-#include "math.h"
 //#if !defined(HIPS_H__INCLUDED)  // Only include header file once
 //#define HIPS_H__INCLUDED
 
@@ -31,9 +30,75 @@ typedef unsigned short uint16;
 typedef signed long int32;
 typedef unsigned long uint32;
 
-#define SER_BUFFER_SIZE  80
+#define SER_BUFFER_SIZE  32		// command lines are short; RAM is nearly full
 
-#define SYSCLK	 8000000		// SYSCLK / SPI_RATE should be evenly divisible
+/* clock configuration: everything below is derived from these at compile time */
+#define SYSCLK_MHZ	8			// DCO = MCLK = SMCLK: 1, 8, 12 or 16 (16 needs VCC >= 3.3V)
+#define UART_BAUD	115200UL	// USCI_A1 to the host
+#define SAMPLE_RATE_MAX	50000UL		// ADC12 sequences per second at reset, see SAMPLE_RATE
+#define TICK_HZ		40			// Timer A switch poll tick
+#define ADC12CLK_MAX 6300000UL	// datasheet limit for ADC12CLK
+#define ADC12_CONV_CLKS	17		// ADC12CLKs per channel: 4 sample + 13 convert
+
+#define SYSCLK		(SYSCLK_MHZ * 1000000UL)
+
+#if SYSCLK_MHZ == 1
+#define CAL_BC1		CALBC1_1MHZ
+#define CAL_DCO		CALDCO_1MHZ
+#elif SYSCLK_MHZ == 8
+#define CAL_BC1		CALBC1_8MHZ
+#define CAL_DCO		CALDCO_8MHZ
+#elif SYSCLK_MHZ == 12
+#define CAL_BC1		CALBC1_12MHZ
+#define CAL_DCO		CALDCO_12MHZ
+#elif SYSCLK_MHZ == 16
+#define CAL_BC1		CALBC1_16MHZ
+#define CAL_DCO		CALDCO_16MHZ
+#else
+#error "SYSCLK_MHZ must be 1, 8, 12 or 16 (DCO calibration constants)"
+#endif
+
+// UART, low-frequency mode: N = SYSCLK / baud, UCBRx = INT(N), UCBRSx = round(frac(N) * 8)
+#define UART_BR		(SYSCLK / UART_BAUD)
+#define UART_BRS	((SYSCLK * 8 + UART_BAUD / 2) / UART_BAUD - UART_BR * 8)
+#define UART_ACTUAL	(SYSCLK * 8 / (UART_BR * 8 + UART_BRS))
+#if UART_BR < 3
+#error "UART_BAUD too high for SYSCLK"
+#endif
+#if UART_ACTUAL * 50 > UART_BAUD * 51 || UART_ACTUAL * 50 < UART_BAUD * 49
+#error "UART_BAUD cannot be made within 2% from SYSCLK"
+#endif
+
+// ADC12CLK = SMCLK / ADC12_DIV, the smallest divider within the datasheet limit
+#define ADC12_DIV	((SYSCLK + ADC12CLK_MAX - 1) / ADC12CLK_MAX)
+#if ADC12_DIV > 8
+#error "no ADC12 clock divider for SYSCLK"
+#endif
+
+// Timer B period (up mode, TBCCR0 = period - 1) in SMCLK cycles at reset: SAMPLE_RATE_MAX,
+// or as fast as A2 and A1 can both convert in one period (ADCRATE_MIN) if that is slower.
+// 'R' changes the period at run time, down to ADCRATE_MIN.
+// The original firmware ran 125k at 8MHz: a 65-cycle period with ADC12CLK at 8MHz, over
+// the datasheet limit. The fastest legal period there is 68 (117.6k), which leaves 60
+// cycles a sample for processing, too few for the NLMS canceller or any channel filter.
+// 50k (160 cycles, 152 for processing) runs 8 NLMS taps; 'R 68' is the fastest plain
+// capture and subtraction, longer periods make room for the filters (filter.c).
+#define ADCRATE_MIN	(2 * ADC12_CONV_CLKS * ADC12_DIV)
+#if SYSCLK / SAMPLE_RATE_MAX >= ADCRATE_MIN
+#define ADCRATE		(SYSCLK / SAMPLE_RATE_MAX)
+#else
+#define ADCRATE		ADCRATE_MIN
+#endif
+#if ADCRATE > 65535
+#error "SAMPLE_RATE_MAX too low for SYSCLK"
+#endif
+#define SAMPLE_RATE	(SYSCLK / ADCRATE)	// at reset: 50k at 8MHz and 16MHz
+
+// Timer A runs at SMCLK / 8
+#define TICK_COUNT	(SYSCLK / 8 / TICK_HZ)
+#if TICK_COUNT > 65536
+#error "TICK_HZ too low for SYSCLK"
+#endif
 
 #define ISRFLG_TWOHZ    BIT2
 #define ISRFLG_ADC12_BIT BIT3
@@ -64,6 +129,10 @@ struct Voltage
     int     delta;
     int     mid;
     int     Time[3];
+    int     mean;
+    int     rms;        // about the mean
+    int     peakAt;     // sample index of peak
+    int     minAt;      // sample index of min
   };
 
 //void InitUart(void);
@@ -71,7 +140,9 @@ struct Voltage
 //void InitTimers(void);
 //void Set_DCO(void);
 
-void freqCalc(volatile unsigned int voltage[Num_of_Results], int *offset, double frequency[Num_of_Results]);
+// frequency in centi-Hz from zero crossings, in fixed point (freq.c)
+unsigned long freqCalc(const volatile unsigned int *voltage, unsigned int count, int mid,
+                       int hyst, unsigned long rate, unsigned int *confidence);
 
 #endif //  if !defined(GFA_H__INCLUDED)
 
@@ -0,0 +1,203 @@
+/*
+ * goertzel.c
+ *
+ *  Goertzel detector bank (see goertzel.h).
+ *
+ *  Per bin and averaged input:
+ *      s0 = x + 2 cos w * s1 - s2
+ *  with s1 split into 15-bit halves so 2 cos w * s1 is two MPYS, about
+ *  40 cycles in all. Per raw sample the averaging is one add and a
+ *  count. With shift 4 a full bank of 16 bins averages about 50 cycles
+ *  per sample, which fits next to the subtraction at the default rate.
+ *  At the end of a result the bin is
+ *      y = s1 - e^-jw s2 = (s1 - cos w * s2) + j sin w * s2
+ *  and the tone amplitude is 2|y| / len.
+ */
+
+#include "gfa.h"
+#include "fixmath.h"
+#include "goertzel.h"
+
+static struct GzBin *gzBin;
+static unsigned int gzCount = 0;        // bins in use
+static unsigned int gzShift;            // log2 of the samples averaged per input
+static unsigned int gzLen;              // averaged inputs per result
+static unsigned int gzN;                // inputs taken towards the current result
+static unsigned int gzLeft;             // samples until the next input
+static unsigned long gzAcc;             // their sum
+static unsigned int gzNext;             // index expected next, anything else is a gap
+static unsigned long gzResults;         // results since Gz_Restart()
+
+/***************************************************************************************
+ * Function: Gz_Init()                                                                 *
+ * Input Parameters: bins  - GZ_BYTES of RAM for the bank                              *
+ *                   shift - inputs are averages of 2^shift samples                    *
+ *                   len   - averaged inputs per result, 1..GZ_MAX_LEN                 *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Starts an empty bank.                                                          *
+ ***************************************************************************************/
+void Gz_Init(struct GzBin *bins, unsigned int shift, unsigned int len) {
+    gzBin = bins;
+    gzCount = 0;
+    gzShift = shift;
+    gzLen = len;
+    Gz_Restart();
+}
+
+/***************************************************************************************
+ * Function: Gz_Add()                                                                  *
+ * Input Parameters: hz   - frequency of the new bin                                   *
+ *                   rate - samples per second                                         *
+ * Output: ERR_OK, or ERR_VALUE if the bank is full or hz is out of range              *
+ * Description:                                                                        *
+ *      hz must be below half the averaged rate and at least 1/256 of it: lower,       *
+ *      2 cos w is too close to 2 for a Q14 coefficient to place the bin. The          *
+ *      averaging also attenuates tones near half the averaged rate (sinc).            *
+ ***************************************************************************************/
+int Gz_Add(unsigned int hz, unsigned long rate) {
+    unsigned int angle;
+    struct GzBin *b;
+
+    rate >>= gzShift;
+
+    if (gzCount >= GZ_MAX_BINS || (unsigned long) hz * 2 >= rate
+        || (unsigned long) hz * 256 < rate)
+        return ERR_VALUE;
+
+    angle = (unsigned int) (((unsigned long) hz << 16) / rate);
+    b = &gzBin[gzCount++];
+    b->hz = hz;
+    b->cos = Fix_Cos(angle);
+    b->sin = Fix_Sin(angle);
+    b->s1 = 0;
+    b->s2 = 0;
+    b->amp = 0;
+    b->phase = 0;
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Gz_Restart()                                                              *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Drops the result in progress; the next block is treated as after a gap.        *
+ ***************************************************************************************/
+void Gz_Restart(void) {
+    unsigned int k;
+
+    for (k = 0; k < gzCount; k++) {
+        gzBin[k].s1 = 0;
+        gzBin[k].s2 = 0;
+    }
+    gzN = 0;
+    gzLeft = 1 << gzShift;
+    gzAcc = 0;
+    gzNext = 0xFFFF;
+    gzResults = 0;
+}
+
+/***************************************************************************************
+ * Function: Gz_Finish()                                                               *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Turns the recurrence of every bin into amplitude and phase and clears it.      *
+ *      y is scaled into 15 bits for Fix_Sqrt() and Fix_Atan2(), and the               *
+ *      amplitude scaled back.                                                         *
+ ***************************************************************************************/
+static void Gz_Finish(void) {
+    unsigned int k, shift;
+    struct GzBin *b;
+    long hi, lo, re, im;
+
+    for (k = 0; k < gzCount; k++) {
+        b = &gzBin[k];
+        hi = b->s2 >> 15;
+        lo = b->s2 & 0x7FFF;
+        re = b->s1 - (b->cos * hi + ((b->cos * lo) >> 15));
+        im = b->sin * hi + ((b->sin * lo) >> 15);
+
+        shift = 0;
+        while (re > 16383 || re < -16383 || im > 16383 || im < -16383) {
+            re >>= 1;
+            im >>= 1;
+            shift++;
+        }
+        b->amp = (unsigned int) (((unsigned long) Fix_Sqrt(re * re + im * im)
+                                  << (shift + 1)) / gzLen);
+        b->phase = Fix_Atan2((int) im, (int) re);
+        b->s1 = 0;
+        b->s2 = 0;
+    }
+    gzN = 0;
+    gzResults++;
+}
+
+/***************************************************************************************
+ * Function: Gz_Block()                                                                *
+ * Input Parameters: p            - ring of samples                                    *
+ *                   first, count - block to add, first + count <= ring                *
+ *                   ring         - samples in the ring                                *
+ *                   mid          - DC level taken off each input                      *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Runs the bank over one block. A block that does not continue the previous      *
+ *      one (DMA lapped the processing) starts the result over, since the phase        *
+ *      of every bin would be off by the samples lost.                                 *
+ ***************************************************************************************/
+void Gz_Block(const volatile unsigned int *p, unsigned int first, unsigned int count,
+              unsigned int ring, int mid) {
+    unsigned int i, k;
+    unsigned int last = first + count;
+    unsigned long results = gzResults;
+    struct GzBin *b;
+    struct GzBin *end = gzBin + gzCount;
+    long s0;
+    int x;
+
+    if (first != gzNext) {
+        Gz_Restart();
+        gzResults = results;
+    }
+
+    for (i = first; i < last; i++) {
+        gzAcc += p[i];
+        if (--gzLeft)
+            continue;
+        x = (int) (gzAcc >> gzShift) - mid;
+        gzAcc = 0;
+        gzLeft = 1 << gzShift;
+
+        for (b = gzBin; b < end; b++) {
+            // 2 cos w * s1 = (cos * s1) >> 14, with s1 = hi * 2^15 + lo
+            k = (unsigned int) b->s1 & 0x7FFF;
+            s0 = x + (((long) b->cos * (int) (b->s1 >> 15)) << 1)
+                 + (((long) b->cos * (int) k) >> 14) - b->s2;
+            b->s2 = b->s1;
+            b->s1 = s0;
+        }
+        if (++gzN == gzLen)
+            Gz_Finish();
+    }
+    gzNext = (last >= ring) ? 0 : last;
+}
+
+/***************************************************************************************
+ * Function: Gz_Bins()                                                                 *
+ * Input Parameters: NONE                                                              *
+ * Output: bins in use                                                                 *
+ ***************************************************************************************/
+unsigned int Gz_Bins(void) {
+    return gzCount;
+}
+
+/***************************************************************************************
+ * Function: Gz_Results()                                                              *
+ * Input Parameters: NONE                                                              *
+ * Output: results completed since the bank was (re)started                            *
+ ***************************************************************************************/
+unsigned long Gz_Results(void) {
+    return gzResults;
+}
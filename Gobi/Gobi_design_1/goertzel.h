@@ -0,0 +1,38 @@
+/*
+ * goertzel.h
+ *
+ *  Bank of single-frequency detectors (Goertzel) over one channel. The
+ *  input is first averaged 2^shift samples at a time, which lowers the
+ *  rate the bank runs at, so mains harmonics stay resolvable with Q15
+ *  coefficients and 16 bins cost little per input sample. Every len
+ *  averaged inputs each bin reports the amplitude and phase of its tone.
+ */
+
+#ifndef GOERTZEL_H_
+#define GOERTZEL_H_
+
+#define GZ_MAX_BINS         16
+#define GZ_MAX_SHIFT        8
+#define GZ_MAX_LEN          4096
+
+struct GzBin {
+    unsigned int hz;
+    int cos;                        // cos w in Q15, read as 2 cos w in Q14
+    int sin;
+    long s1;                        // last two outputs of the recurrence
+    long s2;
+    unsigned int amp;               // last result: amplitude in ADC12 counts
+    int phase;                      // and phase at the last input, binary angle
+};
+
+#define GZ_BYTES            (GZ_MAX_BINS * sizeof(struct GzBin))
+
+void Gz_Init(struct GzBin *bins, unsigned int shift, unsigned int len);
+int Gz_Add(unsigned int hz, unsigned long rate);
+void Gz_Restart(void);
+void Gz_Block(const volatile unsigned int *p, unsigned int first, unsigned int count,
+              unsigned int ring, int mid);
+unsigned int Gz_Bins(void);
+unsigned long Gz_Results(void);
+
+#endif /* GOERTZEL_H_ */
@@ -0,0 +1,407 @@
+/*
+ * kernel.c
+ *
+ *  Block kernels (see kernel.h).
+ *
+ *  MCLK cycles per sample, estimated from the instructions; Krn_Check()
+ *  times them on target in KRN_CHECK builds ('Z'), which has not been done
+ *  yet:
+ *      kernel      reference   kernel
+ *      Sub         about 26    about 14    two loads, two 32-bit sums
+ *      Add         about 20    about 9
+ *      Scale       about 45    about 17    one OP2 per sample, rounded
+ *      Mac         about 60    about 18    MACS in RESHI:RESLO, wrap check
+ *      MinMax      about 16    about 8
+ *  The references index volatile arrays, so every element is reloaded and
+ *  every index scaled; the kernels walk pointers, keep the state in
+ *  registers and leave operand 1 of the multiplier loaded. Sub and Add are
+ *  unrolled by two.
+ *  Sub runs in processing mode and Mac under Fix_DotQ15(); Add, Scale
+ *  and MinMax have no caller yet and are kept, with their references, for
+ *  the averaging, gain and peak loops to move onto.
+ *  The kernels stay in FLASH. The F2618 reads it without wait states up to
+ *  16MHz, so KRN_RAMFUNC brings no speed of its own here and costs RAM the
+ *  arena needs: the kernels are about 400 bytes, which ARENA_OTHER_BYTES
+ *  (arena.h) would have to grow by. The runtime copies .TI.ramfunc to RAM
+ *  at boot (BINIT table).
+ *  tests/ builds them with their references on a host (make -C tests).
+ */
+
+#include "gfa.h"
+#include "fixmath.h"
+#include "kernel.h"
+
+#if KRN_RAMFUNC
+#pragma CODE_SECTION(Krn_Sub, ".TI.ramfunc")
+#pragma CODE_SECTION(Krn_Add, ".TI.ramfunc")
+#pragma CODE_SECTION(Krn_Scale, ".TI.ramfunc")
+#pragma CODE_SECTION(Krn_Mac, ".TI.ramfunc")
+#pragma CODE_SECTION(Krn_MinMax, ".TI.ramfunc")
+#endif
+
+/***************************************************************************************
+ * Function: Krn_Sub()                                                                 *
+ * Input Parameters: out  - a - b + ofs, may be a or b                                 *
+ *                   a, b - samples                                                    *
+ *                   n    - samples in each                                            *
+ *                   ofs  - offset added back                                          *
+ *                   sum  - a and b are added to sum[0] and sum[1]                     *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Unsigned, so the result wraps like the ADC12 arithmetic it replaces.           *
+ ***************************************************************************************/
+void Krn_Sub(unsigned int *out, const unsigned int *a, const unsigned int *b,
+             unsigned int n, unsigned int ofs, unsigned long *sum) {
+    unsigned int *end = out + n;
+    unsigned long sa = sum[0];
+    unsigned long sb = sum[1];
+    unsigned int x, y;
+
+    if (n & 1) {
+        x = *a++;
+        y = *b++;
+        sa += x;
+        sb += y;
+        *out++ = x - y + ofs;
+    }
+    while (out < end) {
+        x = *a++;
+        y = *b++;
+        sa += x;
+        sb += y;
+        *out++ = x - y + ofs;
+        x = *a++;
+        y = *b++;
+        sa += x;
+        sb += y;
+        *out++ = x - y + ofs;
+    }
+    sum[0] = sa;
+    sum[1] = sb;
+}
+
+/***************************************************************************************
+ * Function: Krn_Add()                                                                 *
+ * Input Parameters: out  - a + b, may be a or b                                       *
+ *                   a, b - samples                                                    *
+ *                   n    - samples in each                                            *
+ * Output: NONE                                                                        *
+ ***************************************************************************************/
+void Krn_Add(unsigned int *out, const unsigned int *a, const unsigned int *b,
+             unsigned int n) {
+    unsigned int *end = out + n;
+
+    if (n & 1)
+        *out++ = *a++ + *b++;
+    while (out < end) {
+        *out++ = *a++ + *b++;
+        *out++ = *a++ + *b++;
+    }
+}
+
+/***************************************************************************************
+ * Function: Krn_Scale()                                                               *
+ * Input Parameters: out  - a * gain, may be a                                         *
+ *                   a    - Q15 samples                                                *
+ *                   n    - samples                                                    *
+ *                   gain - Q15                                                        *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Rounded and saturated as Fix_MulQ15(): bit 14 of the product is the            *
+ *      rounding, and only -1 * -1 (RESHI = 0x4000) saturates.                         *
+ ***************************************************************************************/
+void Krn_Scale(int *out, const int *a, unsigned int n, int gain) {
+    int *end = out + n;
+    unsigned int lo;
+    int hi;
+
+    MPYS = gain;                    // stays operand 1 for every OP2 below
+    while (out < end) {
+        OP2 = *a++;
+        lo = RESLO;
+        hi = (int) RESHI;
+        if (hi == 0x4000)
+            *out++ = Q15_ONE;
+        else
+            *out++ = (int) (((hi << 1) | (lo >> 15)) + ((lo >> 14) & 1));
+    }
+}
+
+/***************************************************************************************
+ * Function: Krn_Mac()                                                                 *
+ * Input Parameters: acc  - Q30 sum to add to                                          *
+ *                   a, b - Q15 vectors                                                *
+ *                   n    - their length                                               *
+ * Output: acc + sum of a[i] * b[i] in Q30, saturated after every product              *
+ * Description:                                                                        *
+ *      Accumulates with MACS in RESHI:RESLO, loaded with acc. After every             *
+ *      product the sign of the sum is checked against that of the product: a          *
+ *      flip away from both means it wrapped, and the sum is pinned to the end         *
+ *      it left by, as Fix_MacQ15() does.                                              *
+ ***************************************************************************************/
+long Krn_Mac(long acc, const int *a, const int *b, unsigned int n) {
+    const int *end = a + n;
+    int x, y, hi;
+    int sign = (int) (acc >> 16);
+
+    RESLO = (unsigned int) acc;
+    RESHI = (unsigned int) sign;
+    while (a < end) {
+        x = *a++;
+        y = *b++;
+        MACS = x;
+        OP2 = y;
+        hi = (int) RESHI;
+        if ((hi ^ sign) < 0 && ((x ^ y) ^ sign) >= 0) {
+            RESLO = (sign < 0) ? 0 : 0xFFFF;
+            RESHI = (sign < 0) ? 0x8000 : 0x7FFF;
+            hi = sign;
+        }
+        sign = hi;
+    }
+    return ((long) (int) RESHI << 16) | RESLO;
+}
+
+/***************************************************************************************
+ * Function: Krn_MinMax()                                                              *
+ * Input Parameters: a - samples                                                       *
+ *                   n - samples                                                       *
+ * Output: at - at[0] index of the first minimum, at[1] of the first maximum           *
+ ***************************************************************************************/
+void Krn_MinMax(const unsigned int *a, unsigned int n, unsigned int *at) {
+    const unsigned int *p = a;
+    const unsigned int *end = a + n;
+    const unsigned int *lo = a;
+    const unsigned int *hi = a;
+    unsigned int vlo, vhi;
+
+    if (n) {
+        vlo = vhi = *p;
+        while (++p < end) {
+            if (*p < vlo) {
+                vlo = *p;
+                lo = p;
+            } else if (*p > vhi) {      // cannot be both, vlo <= vhi
+                vhi = *p;
+                hi = p;
+            }
+        }
+    }
+    at[0] = lo - a;
+    at[1] = hi - a;
+}
+
+#if KRN_CHECK
+
+/***************************************************************************************
+ * Function: Krn_SubRef()                                                              *
+ * Input Parameters: as Krn_Sub()                                                      *
+ * Output: as Krn_Sub()                                                                *
+ * Description:                                                                        *
+ *      Indexed loop over volatile buffers, as Data_Process() had.                     *
+ ***************************************************************************************/
+void Krn_SubRef(volatile unsigned int *out, const volatile unsigned int *a,
+                const volatile unsigned int *b, unsigned int n, unsigned int ofs,
+                unsigned long *sum) {
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        sum[0] += a[i];
+        sum[1] += b[i];
+        out[i] = a[i] - b[i] + ofs;
+    }
+}
+
+/***************************************************************************************
+ * Function: Krn_AddRef()                                                              *
+ * Input Parameters: as Krn_Add()                                                      *
+ * Output: as Krn_Add()                                                                *
+ * Description:                                                                        *
+ *      Indexed loop over volatile buffers.                                            *
+ ***************************************************************************************/
+void Krn_AddRef(volatile unsigned int *out, const volatile unsigned int *a,
+                const volatile unsigned int *b, unsigned int n) {
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        out[i] = a[i] + b[i];
+}
+
+/***************************************************************************************
+ * Function: Krn_ScaleRef()                                                            *
+ * Input Parameters: as Krn_Scale()                                                    *
+ * Output: as Krn_Scale()                                                              *
+ * Description:                                                                        *
+ *      Fix_MulQ15() per sample.                                                       *
+ ***************************************************************************************/
+void Krn_ScaleRef(volatile int *out, const volatile int *a, unsigned int n, int gain) {
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        out[i] = Fix_MulQ15(a[i], gain);
+}
+
+/***************************************************************************************
+ * Function: Krn_MacRef()                                                              *
+ * Input Parameters: as Krn_Mac()                                                      *
+ * Output: as Krn_Mac()                                                                *
+ * Description:                                                                        *
+ *      Fix_MacQ15() per sample.                                                       *
+ ***************************************************************************************/
+long Krn_MacRef(long acc, const volatile int *a, const volatile int *b, unsigned int n) {
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        acc = Fix_MacQ15(acc, a[i], b[i]);
+    return acc;
+}
+
+/***************************************************************************************
+ * Function: Krn_MinMaxRef()                                                           *
+ * Input Parameters: as Krn_MinMax()                                                   *
+ * Output: as Krn_MinMax()                                                             *
+ * Description:                                                                        *
+ *      Indexed loop over a volatile buffer.                                           *
+ ***************************************************************************************/
+void Krn_MinMaxRef(const volatile unsigned int *a, unsigned int n, unsigned int *at) {
+    unsigned int i;
+
+    at[0] = 0;
+    at[1] = 0;
+    for (i = 1; i < n; i++) {
+        if (a[i] < a[at[0]])
+            at[0] = i;
+        if (a[i] > a[at[1]])
+            at[1] = i;
+    }
+}
+
+/***************************************************************************************
+ * Function: Krn_Fill()                                                                *
+ * Input Parameters: p    - buffer                                                     *
+ *                   n    - words                                                      *
+ *                   mask - 0x0FFF for ADC12 samples, 0xFFFF for Q15                   *
+ *                   seed - state of the generator, updated                            *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Pseudo-random test data (16-bit LCG). Q15 data starts with -1.0 so the         *
+ *      saturating cases are always hit.                                               *
+ ***************************************************************************************/
+static void Krn_Fill(unsigned int *p, unsigned int n, unsigned int mask,
+                     unsigned int *seed) {
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        *seed = *seed * 25173U + 13849U;
+        p[i] = *seed & mask;
+    }
+    if (mask == 0xFFFF)
+        p[0] = 0x8000;
+}
+
+/***************************************************************************************
+ * Function: Krn_Ticks()                                                               *
+ * Input Parameters: t0 - TAR at the start                                             *
+ * Output: Timer A counts since then                                                   *
+ * Description:                                                                        *
+ *      Timer A counts SMCLK/8 up to TACCR0 (InitTimers()); one wrap is allowed.       *
+ ***************************************************************************************/
+static unsigned int Krn_Ticks(unsigned int t0) {
+    unsigned int t1 = TAR;
+
+    return (t1 >= t0) ? t1 - t0 : t1 + TACCR0 + 1 - t0;
+}
+
+#define KRN_TENTHS(t, n)    ((unsigned int) (((unsigned long) (t) * 80) / (n)))
+
+/***************************************************************************************
+ * Function: Krn_Check()                                                               *
+ * Input Parameters: mem - KRN_CHECK_BYTES(n) of RAM                                   *
+ *                   n   - samples per test, 2..                                       *
+ * Output: res - errors and cycles per sample of each kernel, KRN_KERNELS entries      *
+ * Description:                                                                        *
+ *      Runs every kernel and its reference on the same pseudo-random block and        *
+ *      compares the outputs word for word. Interrupts are held off while a            *
+ *      kernel is timed, so n should keep each run well under a Timer A period.        *
+ ***************************************************************************************/
+void Krn_Check(int *mem, unsigned int n, struct KrnResult *res) {
+    unsigned int *a = (unsigned int *) mem;
+    unsigned int *b = a + n;
+    unsigned int *r = b + n;
+    unsigned int *f = r + n;
+    unsigned int seed = 1;
+    unsigned long sumR[2] = { 0, 0 };
+    unsigned long sumF[2] = { 0, 0 };
+    unsigned int atR[2] = { 0, 0 };
+    unsigned int atF[2] = { 0, 0 };
+    unsigned int i, k, t0;
+    long accR = 0, accF = 0;
+
+    for (k = 0; k < KRN_KERNELS; k++) {
+        Krn_Fill(a, n, (k == 2 || k == 3) ? 0xFFFF : 0x0FFF, &seed);
+        Krn_Fill(b, n, (k == 2 || k == 3) ? 0xFFFF : 0x0FFF, &seed);
+        __disable_interrupt();
+        t0 = TAR;
+        switch (k) {
+        case 0:
+            Krn_SubRef(r, a, b, n, 2048, sumR);
+            break;
+        case 1:
+            Krn_AddRef(r, a, b, n);
+            break;
+        case 2:
+            Krn_ScaleRef((int *) r, (int *) a, n, -23170);
+            break;
+        case 3:
+            accR = Krn_MacRef(0, (int *) a, (int *) b, n);
+            break;
+        default:
+            Krn_MinMaxRef(a, n, atR);
+            break;
+        }
+        res[k].refCycles = KRN_TENTHS(Krn_Ticks(t0), n);
+        t0 = TAR;
+        switch (k) {
+        case 0:
+            Krn_Sub(f, a, b, n, 2048, sumF);
+            break;
+        case 1:
+            Krn_Add(f, a, b, n);
+            break;
+        case 2:
+            Krn_Scale((int *) f, (int *) a, n, -23170);
+            break;
+        case 3:
+            accF = Krn_Mac(0, (int *) a, (int *) b, n);
+            break;
+        default:
+            Krn_MinMax(a, n, atF);
+            break;
+        }
+        res[k].fastCycles = KRN_TENTHS(Krn_Ticks(t0), n);
+        __enable_interrupt();
+
+        res[k].errors = 0;
+        if (k <= 2) {
+            for (i = 0; i < n; i++)
+                if (r[i] != f[i])
+                    res[k].errors++;
+        }
+        if (k == 0 && (sumR[0] != sumF[0] || sumR[1] != sumF[1]))
+            res[k].errors++;
+        if (k == 2) {
+            // saturation: -1 * -1 only comes up with a gain of -1
+            Krn_ScaleRef((int *) r, (int *) a, n, -32767 - 1);
+            Krn_Scale((int *) f, (int *) a, n, -32767 - 1);
+            for (i = 0; i < n; i++)
+                if (r[i] != f[i])
+                    res[k].errors++;
+        }
+        if (k == 3 && accR != accF)
+            res[k].errors++;
+        if (k == 4 && (atR[0] != atF[0] || atR[1] != atF[1]))
+            res[k].errors++;
+    }
+}
+
+#endif /* KRN_CHECK */
@@ -0,0 +1,50 @@
+/*
+ * kernel.h
+ *
+ *  Block kernels for the per-sample loops: subtract with offset, add,
+ *  Q15 scale, saturating multiply-accumulate and min/max. They take plain
+ *  pointers to a completed block, so unlike loops over the volatile
+ *  capture buffers the compiler can keep values in registers and walk
+ *  pointers. Each has a C reference (Krn_xxxRef) written the way the
+ *  processing loops were, that it must match bit for bit; KRN_CHECK
+ *  builds them and Krn_Check(), which compares and times both.
+ */
+
+#ifndef KERNEL_H_
+#define KERNEL_H_
+
+#define KRN_RAMFUNC         0       // 1 runs the kernels from RAM (.TI.ramfunc)
+#ifndef KRN_CHECK
+#define KRN_CHECK           0       // 1 builds the references and Krn_Check()
+#endif
+
+#define KRN_KERNELS         5       // Sub, Add, Scale, Mac, MinMax
+#define KRN_CHECK_BYTES(n)  (4 * (n) * sizeof(int))
+
+struct KrnResult {
+    unsigned int errors;            // outputs that differ from the reference
+    unsigned int refCycles;         // per sample, in tenths
+    unsigned int fastCycles;
+};
+
+void Krn_Sub(unsigned int *out, const unsigned int *a, const unsigned int *b,
+             unsigned int n, unsigned int ofs, unsigned long *sum);
+void Krn_Add(unsigned int *out, const unsigned int *a, const unsigned int *b,
+             unsigned int n);
+void Krn_Scale(int *out, const int *a, unsigned int n, int gain);
+long Krn_Mac(long acc, const int *a, const int *b, unsigned int n);
+void Krn_MinMax(const unsigned int *a, unsigned int n, unsigned int *at);
+
+#if KRN_CHECK
+void Krn_SubRef(volatile unsigned int *out, const volatile unsigned int *a,
+                const volatile unsigned int *b, unsigned int n, unsigned int ofs,
+                unsigned long *sum);
+void Krn_AddRef(volatile unsigned int *out, const volatile unsigned int *a,
+                const volatile unsigned int *b, unsigned int n);
+void Krn_ScaleRef(volatile int *out, const volatile int *a, unsigned int n, int gain);
+long Krn_MacRef(long acc, const volatile int *a, const volatile int *b, unsigned int n);
+void Krn_MinMaxRef(const volatile unsigned int *a, unsigned int n, unsigned int *at);
+void Krn_Check(int *mem, unsigned int n, struct KrnResult *res);
+#endif
+
+#endif /* KERNEL_H_ */
@@ -3,7 +3,18 @@
 #include <stdlib.h>   // atoi()
 #include <stdio.h>    // sprintf()
 #include <string.h>
-#include <math.h>
+#include "gfa.h"
+#include "arena.h"
+#include "pack12.h"
+#include "fixmath.h"
+#include "nlms.h"
+#include "freq.h"
+#include "fft.h"
+#include "goertzel.h"
+#include "filter.h"
+#include "xcorr.h"
+#include "kernel.h"
+#include "env.h"
 
 #define UART_PRINTF
 
@@ -14,24 +25,306 @@ void InitDMA(void);
 void InitADC(void);
 void InitDAC(void);
 void InitUART(void); // added UART Initialization
-void Data_Process(void);
+void Data_Process(unsigned int first, unsigned int count);
+void Dc_Update(const unsigned long *sum, unsigned int count);
+void Stats_Restart(void);
+void Stats_Block(unsigned int first, unsigned int count);
+void Stats_Finish(void);
+void Stats_Report(void);
 void UART_Data_Out(void);
-void read_pin(void);
+int read_pin(void);
+void Mode_Enter(void);
+void Mode_Block(void);
+void Acq_Start(unsigned int blocks);
+void Acq_Stop(void);
+void Acq_Service(void);
+unsigned int Acq_Check(void);
+int Ilv_Start(unsigned int channels);
+void Ilv_Stop(void);
+unsigned int Ilv_Sample(unsigned int ch, unsigned int frame);
+void Acq_BlockDone(unsigned int tbr);
+void Hlth_Restart(void);
+void Hlth_Report(void);
+int Capture_Config(unsigned int channels, unsigned int samples, unsigned int stages,
+                   unsigned int packed);
+void Rec_Block(unsigned int first, unsigned int count);
+unsigned int Trig_Window(void);
+unsigned int Trig_Pre(void);
+void Trig_Arm(void);
+int Trig_Scan(unsigned int prev, const unsigned int *p, unsigned int count);
+void Trig_Block(unsigned int first, unsigned int count, unsigned int skipped);
+void Trig_Freeze(void);
+int Avg_Config(unsigned int shift);
+void Avg_Start(void);
+void Avg_Add(void);
+int Ets_Config(unsigned int samples, unsigned int slots);
+void Ets_Start(void);
+void Ets_Arm(void);
+void Ets_Add(void);
+int Dec_Config(unsigned int shift, unsigned int samples);
+void Dec_Reset(void);
+void Dec_Block(unsigned int first, unsigned int count);
+int Log_Config(const unsigned int *ratio, unsigned int stages);
+void Log_Restart(void);
+void Log_Input(unsigned int k, unsigned int min, unsigned int max, unsigned int mean);
+void Log_Block(unsigned int first, unsigned int count);
+void Log_Drain(void);
+unsigned int Proc_Cycles(unsigned int taps, unsigned int channels, unsigned int packs);
+int Nlms_Config(unsigned int taps, unsigned int muShift);
+int Fft_Config(unsigned int points);
+int Gz_Config(unsigned int shift, unsigned int len);
+int Filt_Config(unsigned int ch, unsigned int design);
+int Env_Config(unsigned int shift, unsigned int smooth, unsigned int decim);
+void *Stage_Alloc(unsigned int stage, unsigned int bytes);
+void Stage_Free(unsigned int stage);
+void Scratch_Free(void);
+void Cmd_Process(char *line);
+unsigned int Cmd_Args(char *p, unsigned int *args, unsigned int max);
 
 // Constants
-#define ADCRATE 64
 #define DEBUG 0
-#define NUMOFRESULTS 1280
+#define NUMOFRESULTS 1280                   // default samples per channel
 #define PORTFLAG BIT3
-#define ISRFLG_DMA_BIT BIT2
+#define ACQ_BLOCKS 2                        // ping-pong: buffers are split in halves
+#define TRIG_BLOCKS 16                      // blocks in the pre-trigger ring
+#define TRIG_OFF 0                          // trigger types ('T' command)
+#define TRIG_RISING 1                       // level crossed upwards
+#define TRIG_FALLING 2                      // level crossed downwards
+#define TRIG_SLOPE 3                        // step between samples >= level (<= if negative)
+#define TRIG_ARMED 1                        // trigger states
+#define TRIG_FIRED 2
+#define TRIG_DONE 3
+#define AVG_MAX_SHIFT 10                    // up to 1024 captures: 12 + 10 bits per sum
+#define ETS_MAX_SLOTS 32                    // equivalent-time points per sample period
+#define ETS_MAX_REPS 8                      // repetitions per slot before giving up
+#define ETS_EMPTY 0xFFFF                    // waveform point not sampled yet
+#define DEC_MAX_SHIFT 8                     // ratio up to 256: 16-bit results
+#define DEC_SAMPLES 512                     // default decimated record length
+#define LOG_RING 64                         // logged records held until drained
+#define NLMS_MU_SHIFT 4                     // default NLMS step size 2^-4
+#define PROC_CYCLES (adcRate - 8)           // per sample for processing, DMA takes the rest
+#define SAMPLE_HZ (SYSCLK / adcRate)        // samples per second at the current period
+#define SUB_CYCLES 26                       // A2 - A1 per sample without the NLMS canceller
+#define SKEW_CYCLES 75                      // the same moving A1 to the A2 instant (skewFrac)
+#define STATS_CYCLES 65                     // STATS_ADD() per result with 'S' on
+#define DC_FRAC 4                           // fraction bits of the DC estimates
+#define DC_SHIFT 3                          // DC follows block means with 1/8 weight
+#define STATS_SQ_SHIFT 4                    // squares are summed >> 4 to stay in 32 bits
+#define STATS_STREAM 2                      // 'S 2': send the statistics of every capture
+#define FREQ_HYST 32                        // default crossing hysteresis, ADC12 counts
+#define FREQ_MAX_LAPS 64                    // evaluate after this many captures regardless
+#define GZ_SHIFT 4                          // default Goertzel input: 16 averaged, 7.8k/s
+#define GZ_LEN 512                          // default averaged inputs per result (65ms)
+#define XC_LAGS 8                           // default lags searched each way by 'X'
+#define XC_BLOCK_LAGS 1                     // lags correlated per processed block
+#define XC_BLOCK_SAMPLES 128                // of each block, so a lag costs about 0.3ms
+#define ENV_SMOOTH 2                        // default envelope weight 1/4 per point
+#define ENV_DECIM 256                       // default samples per envelope point (2ms)
+#define STAGE_AVG 0                         // optional stages, each with its own arena region
+#define STAGE_ETS 1
+#define STAGE_DEC 2
+#define STAGE_LOG 3
+#define STAGE_NLMS 4
+#define STAGE_FFT 5
+#define STAGE_GZ 6
+#define STAGE_FILT 7
+#define STAGE_ENV 8
+#define STAGES 9
+#define PACK_BLOCK 32                       // samples per staging half when packing
+#define PACK_CYCLES(r) (20 * (r) + 35)      // Rec_Block() per sample of r regions, and the
+                                            // Dc_Update() divides and service every block
+#define ILV_CHANNELS 0                      // 'I' at reset: 2..8 inputs through one DMA, 0 = off
+#define ILV_MAX_CHANNELS 8
+#define ILV_CYCLES_PER_CH 20                // 4 sample + 13 convert + sync, in ADC12CLKs
+#define ILV_MIN_PERIOD 96                   // per-frame DMA_ISR needs ~30 of these cycles
 
 // Global Variables
 int sysMode = 0;
-int ISRFLAG;
+volatile unsigned int ISRFLAG = 0;     // events posted by ISRs (ISRFLG_xxx)
 
-volatile unsigned int buffer0[NUMOFRESULTS];
-volatile unsigned int buffer1[NUMOFRESULTS];
-volatile unsigned int buffer2[NUMOFRESULTS];
+// Sample buffers, carved out of the arena by Capture_Config()
+volatile unsigned int *buffer0;             // channel A2
+volatile unsigned int *buffer1;             // channel A1, 0 when capturing one channel
+volatile unsigned int *buffer2;             // processed output, 0 when there is no stage
+volatile unsigned int *procOut;             // where Data_Process() results land
+unsigned int numResults = 0;                // samples per region
+unsigned int capChannels = 0;               // 1 or 2
+unsigned int blockSize = 0;                 // samples per DMA block (set by Acq_Start)
+
+// Packed 12-bit records, 0 unless Capture_Config() was asked to pack.
+// buffer0/1/2 are then small DMA staging rings that are packed per half.
+unsigned char *packed0;
+unsigned char *packed1;
+unsigned char *packed2;
+unsigned char *packedOut;                   // record holding the procOut region
+unsigned int recSamples = 0;                // samples per record
+unsigned int recRegions = 0;                // regions recorded, 0 = not packed
+unsigned int recPos = 0;                    // next sample written
+unsigned int recFilled = 0;                 // samples held, up to recSamples
+
+// Acquisition health ('H' command)
+volatile unsigned int hlthAdcOv = 0;        // ADC12MEMx overwritten before DMA read it
+volatile unsigned int hlthAdcTov = 0;       // sample request while still converting
+volatile unsigned long hlthSamples = 0;     // samples per channel DMA completed
+volatile unsigned long hlthTicks = 0;       // Timer A ticks with capture running
+volatile unsigned int hlthLatMin = 0xFFFF;  // Timer B trigger edge to DMA_ISR,
+volatile unsigned int hlthLatMax = 0;       // in SMCLK cycles
+
+// Timer B period in SMCLK cycles ('R' command), one A2/A1 sequence each
+unsigned int adcRate = ADCRATE;
+
+// A1 is sampled one conversion after A2 ('K' command)
+int skewFrac = (int) ((ADC12_CONV_CLKS * ADC12_DIV * 32768L) / ADCRATE);  // Q15 of a period
+unsigned int skewPrev;                      // raw A1 before sample skewNext
+unsigned int skewNext = 0xFFFF;             // sample that continues skewPrev
+
+// DC level of A2 and A1, Q(DC_FRAC) ADC12 counts, tracked by Data_Process()
+unsigned int dcLevel[2] = { 2048 << DC_FRAC, 2048 << DC_FRAC };
+
+// Statistics of each processed capture ('S' command). Samples are taken
+// relative to the DC level so squares of 12-bit swings fit in 24 bits.
+struct StatAcc {
+    unsigned int ref;                       // level the sums are taken against
+    int max;                                // extremes, relative to ref
+    int min;
+    unsigned int maxAt;
+    unsigned int minAt;
+    unsigned int n;                         // samples summed
+    long sum;                               // sample - ref
+    unsigned long sq;                       // (sample - ref)^2 >> STATS_SQ_SHIFT
+};
+struct StatAcc statAcc;                     // capture in progress
+struct Voltage stats;                       // last complete capture
+unsigned int statsOn = 0;                   // 0 off, 1 on, STATS_STREAM also sends them
+
+// Frequency of the processed results ('F' command)
+unsigned int freqHyst = 0;                  // crossing hysteresis, 0 = not tracked
+unsigned int freqLaps = 0;                  // captures since the last estimate
+unsigned long freqCentiHz = 0;              // last estimate
+unsigned int freqConf = 0;                  // its confidence, 0..100
+
+// One sample into statAcc: two compares, two adds and one MPYS
+#define STATS_ADD(v, i)                                                 \
+    do {                                                                \
+        int d_ = (int) ((v) - statAcc.ref);                             \
+        if (d_ > statAcc.max) {                                         \
+            statAcc.max = d_;                                           \
+            statAcc.maxAt = (i);                                        \
+        }                                                               \
+        if (d_ < statAcc.min) {                                         \
+            statAcc.min = d_;                                           \
+            statAcc.minAt = (i);                                        \
+        }                                                               \
+        statAcc.sum += d_;                                              \
+        statAcc.sq += (unsigned long) ((long) d_ * d_) >> STATS_SQ_SHIFT; \
+    } while (0)
+
+// Serial command line (filled by USCIAB1RX_ISR)
+char serBuffer[SER_BUFFER_SIZE];
+unsigned int serCount = 0;
+volatile int serReady = 0;
+
+// Continuous acquisition state (shared with DMA_ISR)
+volatile unsigned int acqBlocksFilled = 0;  // blocks completed by DMA0/DMA2
+volatile unsigned int acqOverruns = 0;      // blocks overwritten before processing
+volatile unsigned int acqDesync = 0;        // DMA2 finished a block without DMA0
+unsigned int acqBlocksDone = 0;             // blocks run through Acq_Service()
+unsigned int acqBlocks = ACQ_BLOCKS;        // blocks in the ring
+unsigned int acqRing = 0;                   // samples in the ring, acqBlocks * blockSize
+unsigned int acqReloadOfs = 0;              // block DMA reloads after the current one
+unsigned int acqDoneOfs = 0;                // next block for Acq_Service()
+int acqContinuous = 0;                      // ping-pong DMA is armed
+int acqFrozen = 0;                          // a triggered capture is held in the ring
+
+// Triggered capture (collect mode, 'T' command)
+int trigType = TRIG_OFF;
+unsigned int trigChannel = 0;               // 0 = buffer0 (A2), 1 = buffer1 (A1)
+int trigLevel = 0;                          // crossing level, or step per sample
+unsigned int trigPost = 0;                  // samples kept after the trigger
+int trigState = TRIG_OFF;
+unsigned int trigPrev;                      // last sample of the previous block
+unsigned int trigIndex = 0;                 // ring index of the trigger sample
+int trigLeft;                               // post-trigger samples still to come
+unsigned int trigStart;                     // ring index of the oldest sample kept
+
+// Coherent averaging of triggered captures ('A' command)
+unsigned long *avgSum;                      // Trig_Window() sums in the arena, 0 = off
+unsigned int avgShift = 0;                  // log2 of the captures averaged
+unsigned int avgCount = 0;                  // captures summed so far
+
+// Equivalent-time sampling of triggered repetitions ('E' command)
+unsigned int *etsWave;                      // etsSamples * etsSlots points, 0 = off
+unsigned int etsSamples = 0;                // real samples kept per repetition
+unsigned int etsSlots = 0;                  // points per sample period
+unsigned int etsReps = 0;                   // repetitions taken
+unsigned int etsFilled = 0;                 // points holding a sample
+
+// Oversampling and decimation in processing mode ('D' command)
+unsigned int *decOut;                       // decimated record (ring), 0 = off
+unsigned int decShift = 0;                  // log2 of the decimation ratio
+unsigned int decSamples = 0;                // record length
+unsigned int decPos = 0;                    // next result written
+unsigned int decFilled = 0;                 // results held, up to decSamples
+unsigned long decAcc;                       // integrator
+unsigned int decLeft;                       // inputs until the next dump
+
+// Long-duration logging in processing mode ('L' command)
+struct LogStat {                            // one decimation stage
+    unsigned int ratio;                     // inputs per output
+    unsigned int count;                     // inputs taken this period
+    unsigned int min;
+    unsigned int max;
+    unsigned long sum;
+};
+struct LogRec {                             // one output of the last stage
+    unsigned int min;
+    unsigned int max;
+    unsigned int mean;
+};
+struct LogStat *logStat;                    // stages, 0 = off
+struct LogRec *logRing;                     // LOG_RING records
+unsigned int logStages = 0;
+unsigned int logHead = 0;                   // next record written
+unsigned int logCount = 0;                  // records not drained yet
+unsigned long logSeq = 0;                   // records produced since Log_Config()
+unsigned int logDropped = 0;                // records overwritten before draining
+
+// Adaptive noise canceller in processing mode ('N' command)
+int *nlmsMem;                               // NLMS_BYTES(nlmsTaps) in the arena, 0 = off
+unsigned int nlmsTaps = 0;
+unsigned int nlmsMuShift = NLMS_MU_SHIFT;
+
+// Spectrum instead of samples in UART mode ('P' command)
+int *fftBuf;                                // fftPoints ints in the arena, 0 = off
+unsigned int fftPoints = 0;
+
+// Goertzel tone detectors over processed results ('G' command)
+struct GzBin *gzMem;                        // GZ_BYTES in the arena, 0 = off
+
+// Per-channel filters ahead of the processing ('B' command)
+int *filtMem;                               // FILT_BYTES in the arena, 0 = off
+
+// Envelope and RMS points of processed results ('V' command)
+int *envMem;                                // ENV_BYTES(shift) in the arena, 0 = off
+unsigned int envShift = 0;
+
+// Delay of A1 behind A2 from their cross-correlation ('X' command)
+unsigned int xcLags = 0;                    // lags searched each way per capture, 0 = off
+int xcDelay = 0;                            // Q(XC_FRAC) samples
+int xcPeak = 0;                             // correlation coefficient there, Q15
+
+unsigned int stageBase;                     // arena mark above the capture regions
+unsigned int stageEnd[STAGES];              // arena mark above each stage's region, 0 = none
+
+// Interleaved capture state (shared with DMA_ISR)
+const unsigned char ilvInputs[ILV_MAX_CHANNELS] = { 2, 1, 0, 3, 4, 5, 6, 7 };  // ADC12MEMx -> Ax
+volatile unsigned int *ilvNext;             // frame DMA0 reloads after the current one
+volatile unsigned int *ilvEnd;              // end of the ring, so DMA_ISR needs no multiply
+volatile unsigned int ilvFrame = 0;         // frame being written = oldest in the ring
+unsigned int ilvWanted = ILV_CHANNELS;      // inputs for collect/UART modes, 0 = two DMAs
+unsigned int ilvChannels = 0;
+unsigned int ilvFrames = 0;
+int ilvActive = 0;
 
 /***************************************************************************************
  * Function: main()                                                                    *
@@ -40,58 +333,173 @@ volatile unsigned int buffer2[NUMOFRESULTS];
  * Description:                                                                        *
  *      Main program where the intializing                                             *
  *      functions are called from to setup system.                                     *
- *      In a while loop that is always true, will execute                              *
- *      the main functionality of system. Will change modes based on input             *
- *      from P4.1 and P4.2                                                            *
+ *      The CPU then sleeps in LPM0 until an interrupt posts an event in               *
+ *      ISRFLAG: the Timer A tick samples P4.4/P4.5 and changes modes, a DMA           *
+ *      block completion runs the work of the current mode on that block, a            *
+ *      complete serial line is run as a command.                                      *
  ***************************************************************************************/
 int main(void) {
-    int i = 0;
+    unsigned int events;
     // call setup functions
     InitSystem();
     InitTimers();
     InitADC();
     InitDAC();
+    Capture_Config(2, NUMOFRESULTS, 0, 0);
     InitDMA();
     InitUART();
 
+    Mode_Enter();
+    __enable_interrupt();
+
     while (1) {
-        read_pin();
-        switch (sysMode) {
-        case 0:                     // Standby Mode
-            P4OUT = 0x01;           // LED3 ON
-            ADC12CTL0 &= ~ENC;
-            DAC12_1DAT &= 0x0000;
-            DAC12_0DAT &= 0x0000;
-            break;
-        case 1:                    // Collect Data Mode
-            ADC12CTL0 |= ENC;
-            P4OUT = 0x02;           // LED4 ON
+        // check and sleep atomically so an event posted in between is not missed
+        __disable_interrupt();
+        if (ISRFLAG == 0)
+            __bis_SR_register(LPM0_bits + GIE);
+        __disable_interrupt();
+        events = ISRFLAG;
+        ISRFLAG = 0;
+        __enable_interrupt();
 
-            //re-configuring DMA1 in case of re-sampling signals.
-            DMA1SA = (void (*)()) &buffer0;
-            DMA1DA = (void (*)()) &DAC12_1DAT;
+        if (events & ISRFLG_TIC_BIT) {
+            if (read_pin())
+                Mode_Enter();
+        }
+        if (events & ISRFLG_DMA_BIT)
+            Mode_Block();
+        if (events & ISRFLG_USB_BIT) {
+            Cmd_Process(serBuffer);
+            serCount = 0;
+            serReady = 0;
+        }
+    }
+}
+
+/***************************************************************************************
+ * Function: Mode_Enter()                                                              *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Sets up the system for sysMode. Called once each time the debounced            *
+ *      switch setting changes.                                                        *
+ ***************************************************************************************/
+void Mode_Enter(void) {
+    if (acqContinuous)
+        Acq_Stop();                  // back to single-buffer capture
+    else if (acqFrozen && sysMode != 0 && sysMode != 3)
+        InitDMA();                   // the triggered capture is only kept for UART
+    else if (buffer1 && !(DMA2CTL & DMAEN) && !ilvActive && !acqFrozen)
+        InitDMA();                   // DMA2 was held off in-place results
+    if (sysMode != 1 && sysMode != 3 && ilvActive)
+        Ilv_Stop();
+
+    switch (sysMode) {
+    case 0:                     // Standby Mode
+        P4OUT = 0x01;           // LED3 ON
+        ADC12CTL0 &= ~ENC;
+        DAC12_1DAT &= 0x0000;
+        DAC12_0DAT &= 0x0000;
+        break;
+    case 1:                    // Collect Data Mode
+        ADC12CTL0 |= ENC;
+        P4OUT = 0x02;           // LED4 ON
+
+        if (trigType && !packed0 && trigPost < Trig_Window()) {
+            if (etsWave)
+                Ets_Start();    // interleave phase-stepped repetitions
+            else if (avgSum)
+                Avg_Start();    // sum 2^avgShift triggered captures
+            else
+                Trig_Arm();     // pre-trigger ring until the trigger
             break;
-        case 2:
-            ADC12CTL0 |= ENC;      // Procesing Data
-            P4OUT = 0x04;           // LED5 ON
-
-            //because summation using updated buffer0 and buffer1 (it supposes to use previous buffer0 and buffer1)
-            DMA2CTL&=~DMAEN;
-            DMA0CTL&=~DMAEN;
-            Data_Process();
+        }
+        if (packed0) {
+            Acq_Start(ACQ_BLOCKS);  // records are packed half by half
             break;
-        case 3:
-            ADC12CTL0 |= ENC;      // Send to UART
-            P4OUT = 0x08;          // LED6 ON
+        }
+        if (ilvWanted) {
+            if (!ilvActive)
+                Ilv_Start(ilvWanted);
+        } else {
+            //re-configuring DMA1 in case of re-sampling signals.
+            DMA1SA = (void (*)()) buffer0;
+            DMA1DA = (void (*)()) &DAC12_1DAT;
+        }
+        break;
+    case 2:
+        ADC12CTL0 |= ENC;      // Procesing Data
+        P4OUT = 0x04;           // LED5 ON
+
+        // DMA keeps filling one half of buffer0/buffer1 while
+        // Data_Process() works on the half that was just completed
+        if (decOut)
+            Dec_Reset();
+        if (logStat)
+            Log_Restart();
+        if (nlmsMem)
+            Nlms_Restart();
+        if (statsOn)
+            Stats_Restart();
+        if (freqHyst)
+            Freq_Start(dcLevel[0] >> DC_FRAC, freqHyst, numResults);
+        if (gzMem)
+            Gz_Restart();
+        if (filtMem)
+            Filt_Restart();
+        if (envMem)
+            Env_Restart();
+        Acq_Start(ACQ_BLOCKS);
+        break;
+    case 3:
+        P4OUT = 0x08;          // LED6 ON, Send to UART
+
+        if (acqFrozen) {
+            ADC12CTL0 &= ~ENC;  // DMA is stopped: send the triggered capture once
             UART_Data_Out();
             break;
-        default:                   // Standby mode
-            P4OUT = 0x00;
-            ADC12CTL0 &= ~ENC;
-            DAC12_1DAT &= 0x0000;
-            DAC12_0DAT &= 0x0000;
-            break;
         }
+        if (procOut == buffer1 && !packed0) {
+            // results were written over buffer1: keep DMA2 off them while they
+            // are sent and take the block-ready event from DMA0 instead, before
+            // the first conversion can reach it
+            DMA2CTL &= ~DMAEN;
+            DMA0CTL |= DMAIE;
+        }
+        ADC12CTL0 |= ENC;
+        if (ilvWanted && !ilvActive)
+            Ilv_Start(ilvWanted);
+        break;
+    default:                   // Standby mode
+        P4OUT = 0x00;
+        ADC12CTL0 &= ~ENC;
+        DAC12_1DAT &= 0x0000;
+        DAC12_0DAT &= 0x0000;
+        break;
+    }
+}
+
+/***************************************************************************************
+ * Function: Mode_Block()                                                              *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Runs on every DMA block-ready event, right at the block boundary.              *
+ ***************************************************************************************/
+void Mode_Block(void) {
+    switch (sysMode) {
+    case 1:
+        if (acqContinuous)
+            Acq_Service();
+        break;
+    case 2:
+        Acq_Service();
+        break;
+    case 3:
+        UART_Data_Out();
+        break;
+    default:
+        break;
     }
 }
 
@@ -109,8 +517,9 @@ void InitSystem(void) {
     unsigned int i;
 
     WDTCTL = WDTPW | WDTHOLD;       // stop watchdog timer
-    BCSCTL1 = CALBC1_8MHZ;         // Set DCO to 8MHz
-    DCOCTL = CALDCO_8MHZ;
+    DCOCTL = 0;                     // lowest DCOx/MODx while RSEL changes
+    BCSCTL1 = CAL_BC1;              // Set DCO to SYSCLK_MHZ (gfa.h)
+    DCOCTL = CAL_DCO;
     BCSCTL2 = 0;                  // SMCLK = MCLK = DCOCLK / 1
 
     for (i = 0xfffe; i > 0; i--)
@@ -143,20 +552,22 @@ void InitSystem(void) {
  * Description:                                                                        *
  *      Will Initialize Timers provided
  *      by MSP430 that will be used
- *      in this system. Timer B is used
- *      to toggle every half of ADCRATE(64)                                         *
+ *      in this system. Timer A ticks at
+ *      TICK_HZ to poll the mode switches. Timer B
+ *      runs at SAMPLE_HZ (adcRate cycles) and
+ *      toggles OUT1 halfway through each period.                                      *
  ***************************************************************************************/
 void InitTimers(void) {
     // TIMER A
     TACTL = 0;
     TACTL = TASSEL_2 + TACLR + ID_3 + MC_1;        // SMCLK/8, clear TAR
-    TACCTL0 &= ~CCIE;                               // CCR0 interrupt disabled
-    TACCR0 = 50000;                  // max clock count for compare/capture mode
+    TACCTL0 = CCIE;                                 // CCR0 interrupt: switch poll tick
+    TACCR0 = TICK_COUNT - 1;         // SMCLK/8 / TICK_COUNT = TICK_HZ
 
     TBCTL = TBSSEL_2 + MC_1 + TBCLR;
     TBCCTL1 = OUTMOD_2;       // Toggle at TBCCR1 and Reset at TBCCR0
-    TBCCR0 = ADCRATE;        // Timer B max count is ADCRATE
-    TBCCR1 = (ADCRATE >> 1); // Timer B will toggle every half of ADCRATE
+    TBCCR0 = adcRate - 1;    // Timer B period is adcRate
+    TBCCR1 = (adcRate >> 1); // Timer B will toggle every half of adcRate
 }
 
 /***************************************************************************************
@@ -168,7 +579,7 @@ void InitTimers(void) {
  *      to be used in this system.
  *      Two ADC channels will be used
  *      for converting two analog signals.
- *      Will sample at 235KHz at 12-bit
+ *      Will sample at SAMPLE_HZ at 12-bit
  *      resolution.                                                 *
  ***************************************************************************************/
 void InitADC(void) {
@@ -176,14 +587,15 @@ void InitADC(void) {
     // Reference voltage on = 2.5V
     // Multiple sample and conversion Mode: one trigger to start, rest auto
     // ADC is on
-    ADC12CTL0 = REFON + ADC12ON + REF2_5V + MSC;
+    // Overflow and conversion-time overflow interrupts feed the health counters
+    ADC12CTL0 = REFON + ADC12ON + REF2_5V + MSC + ADC12OVIE + ADC12TOVIE;
 
     // Pulse mode selected
     // Repeat sequence channel mode
-    // ADC12 Clock divider: 1
+    // ADC12 Clock divider: ADC12_DIV, keeps ADC12CLK within its limit
     // ADC12 clock source: SMCLK
     // Sample and hold source: TimerB1 out
-    ADC12CTL1 = SHP + CONSEQ_3 + ADC12SSEL_3 + SHS_3;
+    ADC12CTL1 = SHP + CONSEQ_3 + ADC12SSEL_3 + SHS_3 + (ADC12_DIV - 1) * ADC12DIV0;
 
     // Channel A2(PIN 4) analog input
     // Selected reference voltage: VR+ = VREF+, VR- = AVSS
@@ -230,24 +642,31 @@ void InitDMA(void) {
 
     // DMA0
     DMA0SA = (void (*)()) &ADC12MEM0;
-    DMA0DA = (void (*)()) &buffer0;
-    DMA0SZ = NUMOFRESULTS;
+    DMA0DA = (void (*)()) buffer0;
+    DMA0SZ = numResults;
 
-    DMA0CTL = DMADSTINCR_3 + DMADT_4 + DMAEN;
+    // the block-ready event comes from the last channel moved on a trigger
+    DMA0CTL = DMADSTINCR_3 + DMADT_4 + (buffer1 ? 0 : DMAIE) + DMAEN;
+
+    acqFrozen = 0;                  // DMA overwrites any triggered capture
+    Hlth_Restart();
 
     // DMA1
-    DMA1SA = (void (*)()) &buffer0;
+    DMA1SA = (void (*)()) buffer0;
     DMA1DA = (void (*)()) &DAC12_1DAT;
-    DMA1SZ = NUMOFRESULTS;
+    DMA1SZ = numResults;
 
     DMA1CTL = DMASRCINCR_3 + DMADT_4 + DMAEN;
 
     //DMA2
-    DMA2SA = (void (*)()) &ADC12MEM1;
-    DMA2DA = (void (*)()) &buffer1;
-    DMA2SZ = NUMOFRESULTS;
+    DMA2CTL = 0;
+    if (buffer1) {
+        DMA2SA = (void (*)()) &ADC12MEM1;
+        DMA2DA = (void (*)()) buffer1;
+        DMA2SZ = numResults;
 
-    DMA2CTL = DMADSTINCR_3 + DMADT_4 + DMAEN;
+        DMA2CTL = DMADSTINCR_3 + DMADT_4 + DMAIE + DMAEN;   // block-ready event
+    }
 }
 
 /***************************************************************************************
@@ -262,11 +681,11 @@ void InitDMA(void) {
 void InitUART(void) {
     P3SEL = 0xC0;                             // P3.6,7 = USCI_A1 TXD/RXD
     UCA1CTL1 |= UCSSEL_2;                     // SMCLK
-    UCA1BR0 = 69;                              // 8MHz 115200
-    UCA1BR1 = 0;                              // 8MHz 115200
-    UCA1MCTL = UCBRS2;                        // Modulation UCBRSx = 4 for 8MHz
+    UCA1BR0 = UART_BR & 0xFF;                 // SYSCLK / UART_BAUD (gfa.h)
+    UCA1BR1 = UART_BR >> 8;
+    UCA1MCTL = UART_BRS << 1;                 // Modulation UCBRSx
     UCA1CTL1 &= ~UCSWRST;                   // **Initialize USCI state machine**
-    UC1IE |= UCA1RXIE;                          // Enable USCI_A0 RX interrupt
+    UC1IE |= UCA1RXIE;                          // Enable USCI_A1 RX interrupt
 }
 
 /***************************************************************************************
@@ -274,21 +693,190 @@ void InitUART(void) {
  * Input Parameters: NONE                                                              *
  * Output: NONE                                                                        *
  * Description:                                                                        *
- *      Will sum two digital signals and store into buffer[2]
- *
+ *      Will sum two digital signals and store into procOut
+ *      for samples first .. first+count-1 (one ping-pong half).
+ *      procOut is buffer2 when the capture has a processing stage;
+ *      without one the result is written over buffer1 in place, which
+ *      is safe because DMA is filling the other half.
+ *      A1 is converted skewFrac of a period after A2, so it is moved back
+ *      to the A2 instant first by linear interpolation with the previous
+ *      A1 sample: a1 + (prev - a1) * skewFrac. The raw previous sample is
+ *      carried across blocks in skewPrev since buffer1 may hold results.
+ *      With the NLMS canceller on, the filter replaces the subtraction and
+ *      learns gain, delay and skew from A1 to A2 by itself.
+ *      The DC level of each channel is summed in the same pass (one add per
+ *      sample) and tracked by Dc_Update(), so no offset is hard-coded.
+ *      With statistics on ('S') the subtraction also feeds each result to
+ *      STATS_ADD() as it is written, so procOut is not read back. The copy and
+ *      NLMS paths take a second pass over their block with Stats_Block().
+ *      With no skew and no statistics the subtraction is Krn_Sub() on the
+ *      completed block, which DMA is no longer writing, so it need not be
+ *      read through volatile.
  ***************************************************************************************/
-void Data_Process(void) {
+void Data_Process(unsigned int first, unsigned int count) {
     unsigned int i;
-    DMA1SA = (void (*)()) &buffer2;
+    unsigned int last = first + count;
+    volatile unsigned int *out = procOut;
+    unsigned int a1, prev, v;
+    int frac = skewFrac;
+    unsigned int dc1 = dcLevel[1] >> DC_FRAC;
+    unsigned long sum[2] = { 0, 0 };
+    unsigned int mid[2];
+
+    DMA1SA = (void (*)()) out;
     DMA1DA = (void (*)()) &DAC12_0DAT;
 
-    for (i = 0; i < NUMOFRESULTS; i++) {
-        //-2300 to match DC offset of final output and input signal (buffer0)
-        buffer2[i] = buffer0[i] - buffer1[i] +2100;
+    if (!buffer1) {
+        if (out != buffer0)         // in place there is nothing to copy
+            for (i = first; i < last; i++)
+                out[i] = buffer0[i];    // single channel: nothing to cancel against
+        if (statsOn)
+            Stats_Block(first, count);
+    } else if (nlmsMem) {
+        mid[0] = dcLevel[0] >> DC_FRAC;
+        mid[1] = dc1;
+        Nlms_Block(&out[first], &buffer0[first], &buffer1[first], count, mid, sum);
+        Dc_Update(sum, count);
+        if (statsOn)
+            Stats_Block(first, count);
+    } else if (frac == 0 && !statsOn) {
+        skewPrev = buffer1[last - 1];   // before an in-place result overwrites it
+        Krn_Sub((unsigned int *) &out[first], (const unsigned int *) &buffer0[first],
+                (const unsigned int *) &buffer1[first], count, dc1, sum);
+        skewNext = (last >= acqRing) ? 0 : last;
+        Dc_Update(sum, count);
+    } else {
+        a1 = buffer1[first];
+        prev = (first == skewNext) ? skewPrev : a1;    // no history after a gap
+        for (i = first; i < last; i++) {
+            a1 = buffer1[i];
+            sum[0] += buffer0[i];
+            sum[1] += a1;
+            // A1's DC is added back so the output sits at A2's DC level
+            v = buffer0[i] - (a1 + Q15_MUL((int) (prev - a1), frac)) + dc1;
+            out[i] = v;
+            if (statsOn)
+                STATS_ADD(v, i);
+            prev = a1;
+        }
+        skewPrev = prev;
+        skewNext = (last >= acqRing) ? 0 : last;
+        Dc_Update(sum, count);
+        if (statsOn)
+            statAcc.n += count;
     }
+    if (statsOn && last >= acqRing)
+        Stats_Finish();             // the block closes a pass over the capture
     ADC12CTL0 |= ENC;
 }
 
+/***************************************************************************************
+ * Function: Dc_Update()                                                               *
+ * Input Parameters: sum   - A2 and A1 sums over the block                             *
+ *                   count - samples in the block                                      *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      One-pole low-pass over block means, dc += (mean - dc) >> DC_SHIFT. Only        *
+ *      one divide per channel and block; the time constant is 2^DC_SHIFT blocks.      *
+ ***************************************************************************************/
+void Dc_Update(const unsigned long *sum, unsigned int count) {
+    unsigned int ch;
+    unsigned int mean;
+
+    for (ch = 0; ch < 2; ch++) {
+        mean = (unsigned int) ((sum[ch] << DC_FRAC) / count);  // up to 4095 << 4
+        dcLevel[ch] += (int) (((long) mean - dcLevel[ch]) >> DC_SHIFT);
+    }
+}
+
+/***************************************************************************************
+ * Function: Stats_Restart()                                                           *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Empties statAcc for the next capture, referenced to A2's DC level since        *
+ *      the processed output sits there.                                               *
+ ***************************************************************************************/
+void Stats_Restart(void) {
+    statAcc.ref = dcLevel[0] >> DC_FRAC;
+    statAcc.max = -32767 - 1;
+    statAcc.min = 32767;
+    statAcc.maxAt = 0;
+    statAcc.minAt = 0;
+    statAcc.n = 0;
+    statAcc.sum = 0;
+    statAcc.sq = 0;
+}
+
+/***************************************************************************************
+ * Function: Stats_Block()                                                             *
+ * Input Parameters: first, count - procOut samples to add                             *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Adds a block of results that were not produced by the subtraction loop.        *
+ ***************************************************************************************/
+void Stats_Block(unsigned int first, unsigned int count) {
+    unsigned int i;
+    unsigned int last = first + count;
+    unsigned int v;
+
+    for (i = first; i < last; i++) {
+        v = procOut[i];
+        STATS_ADD(v, i);
+    }
+    statAcc.n += count;
+}
+
+/***************************************************************************************
+ * Function: Stats_Finish()                                                            *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Fills stats from the sums of the capture just completed and starts the         *
+ *      next one. Blocks skipped after an overrun are simply not in the sums.          *
+ *      rms = sqrt(E[d^2] - E[d]^2) with d = sample - ref, so it is the AC part.       *
+ *      Two 32-bit divides and one square root per capture.                            *
+ ***************************************************************************************/
+void Stats_Finish(void) {
+    unsigned int n = statAcc.n;
+    int ref = (int) statAcc.ref;
+    long mean, ms;
+
+    if (n == 0)
+        return;
+    mean = statAcc.sum / (long) n;
+    stats.peak = ref + statAcc.max;
+    stats.min = ref + statAcc.min;
+    stats.delta = statAcc.max - statAcc.min;
+    stats.mid = ref + ((statAcc.max + statAcc.min) >> 1);
+    stats.mean = ref + (int) mean;
+    stats.peakAt = statAcc.maxAt;
+    stats.minAt = statAcc.minAt;
+
+    // E[d^2] with the shift undone, low by less than 1 from the dropped bits
+    ms = (long) ((statAcc.sq / n) << STATS_SQ_SHIFT)
+         + (long) (((statAcc.sq % n) << STATS_SQ_SHIFT) / n);
+    ms -= mean * mean;
+    stats.rms = (int) Fix_Sqrt(ms > 0 ? (unsigned long) ms : 0);
+
+    if (statsOn == STATS_STREAM)
+        Stats_Report();
+    Stats_Restart();
+}
+
+/***************************************************************************************
+ * Function: Stats_Report()                                                            *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Sends the statistics of the last capture, about 50 bytes instead of one        *
+ *      line per sample.                                                               *
+ ***************************************************************************************/
+void Stats_Report(void) {
+    printf("S %u %d %d %d %d %d %d at %d %d\r\n", statsOn, stats.peak, stats.min,
+           stats.mid, stats.delta, stats.mean, stats.rms, stats.peakAt, stats.minAt);
+}
+
 /***************************************************************************************
  * Function: UART_Data_Out()                                                           *
  * Input Parameters: NONE                                                              *
@@ -299,83 +887,2006 @@ void Data_Process(void) {
  ***************************************************************************************/
 void UART_Data_Out(void) {
     unsigned int i = 0;
-    for (i = 0; i < NUMOFRESULTS; i++)
+    unsigned int ch, frame, n;
+    const unsigned char *rec;
+    unsigned int exp;
+
+    if (ilvActive) {
+        // one line per frame, channels in ADC12MEMx order, oldest frame first
+        ADC12CTL0 &= ~ENC;              // freeze the ring while it is sent
+        frame = ilvFrame;
+        for (i = 0; i < ilvFrames; i++) {
+            for (ch = 0; ch < ilvChannels; ch++)
+                printf(ch ? ",%u" : "%u", Ilv_Sample(ch, frame));
+            printf("\r\n");
+            if (++frame == ilvFrames)
+                frame = 0;
+        }
+        ADC12CTL0 |= ENC;
+        return;
+    }
+
+    if (acqFrozen && etsWave) {
+        // equivalent-time waveform, adcRate / etsSlots cycles per line; a
+        // point no repetition hit repeats the one before it
+        frame = etsWave[0];
+        for (i = 0; i < etsSamples * etsSlots; i++) {
+            if (etsWave[i] != ETS_EMPTY)
+                frame = etsWave[i];
+            printf("%u\r\n", frame);
+        }
+        return;
+    }
+
+    if (acqFrozen && avgSum) {
+        // averaged trigger channel, same alignment as a single capture
+        for (i = 0; i < Trig_Window(); i++)
+            printf("%lu\r\n", avgSum[i] >> avgShift);
+        return;
+    }
+
+    if (acqFrozen) {
+        // triggered capture, oldest first; the trigger is line
+        // Trig_Pre() (counting from 0)
+        frame = trigStart;
+        n = Trig_Pre() + 1 + trigPost;
+        for (i = 0; i < n; i++) {
+            if (buffer1)
+                printf("%u,%u\r\n", buffer0[frame], buffer1[frame]);
+            else
+                printf("%u\r\n", buffer0[frame]);
+            if (++frame == acqRing)
+                frame = 0;
+        }
+        return;
+    }
+
+    if (packed0) {
+        // records are frozen outside collect/processing modes, oldest first
+        rec = packedOut;
+        frame = (recFilled < recSamples) ? 0 : recPos;
+        for (i = 0; i < recFilled; i++) {
+            printf("%u\r\n", Pack12_Get(rec, frame));
+            if (++frame == recSamples)
+                frame = 0;
+        }
+        return;
+    }
+
+    if (fftBuf) {
+        // magnitude spectrum of the first fftPoints results, bin i at
+        // i * SAMPLE_HZ / fftPoints Hz
+        Fft_Load(fftBuf, procOut, 0, numResults, fftPoints);
+        exp = Fft_Real(fftBuf, fftPoints);
+        Fft_Magnitude(fftBuf, fftPoints);
+        for (i = 0; i < fftPoints / 2; i++)
+            printf("%lu\r\n", (unsigned long) (unsigned int) fftBuf[i] << exp);
+        return;
+    }
+
+    if (decOut) {
+        // decimated results of the last processing run, oldest first
+        frame = (decFilled < decSamples) ? 0 : decPos;
+        for (i = 0; i < decFilled; i++) {
+            printf("%u\r\n", decOut[frame]);
+            if (++frame == decSamples)
+                frame = 0;
+        }
+        return;
+    }
+
+    for (i = 0; i < numResults; i++)
     {
         //printf("%u,%u\n", buffer0[i], buffer2[i]);
-        printf("%u\r\n",  buffer2[i]);
+        printf("%u\r\n",  procOut[i]);
     }
+#if DEBUG
+    printf("# blocks %u lost %u\r\n", acqBlocksDone, Acq_Check());
+#endif
 }
 
-void read_pin(void) {
-    int k = 0;
-    unsigned SW1;
-    unsigned SW2;
-    unsigned temp1;
-    unsigned temp2;
+/***************************************************************************************
+ * Function: Acq_Start()                                                               *
+ * Input Parameters: blocks - blocks in the ring, ACQ_BLOCKS for ping-pong             *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Re-arms DMA0/DMA2 for continuous capture into a ring of blocks. Each           *
+ *      channel moves blockSize samples per run and DMA_ISR points the reload          *
+ *      address at the next block, so capture never stops while a completed           *
+ *      block is processed. DMA1 is restarted with them so the DAC stays in step       *
+ *      with the ADC index.                                                            *
+ ***************************************************************************************/
+void Acq_Start(unsigned int blocks) {
+    ADC12CTL0 &= ~ENC;
+    DMA0CTL &= ~DMAEN;
+    DMA1CTL &= ~DMAEN;
+    DMA2CTL &= ~DMAEN;
 
-    P4IN = 0;
+    acqBlocks = blocks;
+    blockSize = numResults / blocks;
+    acqRing = blockSize * blocks;
+    acqBlocksFilled = 0;
+    acqBlocksDone = 0;
+    acqOverruns = 0;
+    acqDesync = 0;
+    acqDoneOfs = 0;
+    acqReloadOfs = blockSize;
+    acqFrozen = 0;
+    Hlth_Restart();
 
-    SW1 = P4IN & 0x10;
-    SW2 = P4IN & 0x20;
-    for (k = 1600000; k > 0; k--)
-        ;
-    temp1 = P4IN & 0x10;
-    temp2 = P4IN & 0x20;
+    DMA0DA = (void (*)()) &buffer0[0];
+    DMA0SZ = blockSize;
+    DMA0CTL = DMADSTINCR_3 + DMADT_4 + (buffer1 ? 0 : DMAIE) + DMAEN;
 
+    // DAC0 follows the processed output, DAC1 the raw input otherwise
+    if (sysMode == 2) {
+        DMA1SA = (void (*)()) procOut;
+        DMA1DA = (void (*)()) &DAC12_0DAT;
+    } else {
+        DMA1SA = (void (*)()) buffer0;
+        DMA1DA = (void (*)()) &DAC12_1DAT;
+    }
+    DMA1SZ = acqRing;
+    DMA1CTL = DMASRCINCR_3 + DMADT_4 + DMAEN;
 
-    if (SW1 == temp1 && SW2 == temp2)
-    {
-        if(SW1 == 0x10 & SW2 == 0)
-            sysMode = 1;
-        else if (SW2 == 0x20 && SW1 == 0)
-            sysMode = 2;
-        else if (SW1 == 0x10 && SW2 == 0x20)
-            sysMode = 3;
-        else
-            sysMode = 0;
+    if (buffer1) {
+        DMA2DA = (void (*)()) &buffer1[0];
+        DMA2SZ = blockSize;
+        DMA2CTL = DMADSTINCR_3 + DMADT_4 + DMAIE + DMAEN;
     }
 
+    // the first block is latched by DMAEN, the reload picks up the second
+    DMA0DA = (void (*)()) &buffer0[blockSize];
+    if (buffer1)
+        DMA2DA = (void (*)()) &buffer1[blockSize];
 
-    return;
+    acqContinuous = 1;
+    ADC12CTL0 |= ENC;
 }
-//****************************************************************************************
-#ifdef UART_PRINTF
-//@brief Will send a character over UART
-int fputc(int _c, register FILE *_fp) {
-    // hold until register UC1IFG matches
-    // UCA1TXIFG register
-;   while (!(UC1IFG & UCA1TXIFG))
-        ;
 
-    // Add single integer as unsigned char
-    //to Transmission Buffer
-    UCA1TXBUF = (unsigned char) _c;
+/***************************************************************************************
+ * Function: Acq_Stop()                                                                *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Leaves ping-pong capture and restores the single-buffer DMA setup              *
+ *      used by collect and UART modes.                                                *
+ ***************************************************************************************/
+void Acq_Stop(void) {
+    ADC12CTL0 &= ~ENC;
+    DMA0CTL &= ~DMAEN;
+    DMA1CTL &= ~DMAEN;
+    DMA2CTL &= ~DMAEN;
+    acqContinuous = 0;
+    if (trigState != TRIG_DONE)
+        trigState = TRIG_OFF;       // left collect mode before the trigger
+    TBCCR1 = (adcRate >> 1);        // an equivalent-time run may have moved it
+    InitDMA();
+}
 
-    // return int value as unsigned char
-    return (unsigned char) _c;
+/***************************************************************************************
+ * Function: Acq_Service()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Runs Data_Process() (processing mode), Rec_Block() (packed records) and        *
+ *      Trig_Block() (triggered capture) on every block DMA has completed since        *
+ *      the last call. Channel filters ('B') go first, in place, so everything         *
+ *      downstream sees filtered samples. If DMA lapped the processing the stale       *
+ *      blocks are skipped (and counted by DMA_ISR) so the next block processed is     *
+ *      always intact.                                                                 *
+ *      The frequency estimate is updated once per capture, or once it spans two       *
+ *      periods when the signal is slower than that. The channel delay sweep           *
+ *      correlates XC_BLOCK_LAGS lags on each block, before Data_Process() can         *
+ *      overwrite A1 with results, so it is never all paid for in one block.           *
+ ***************************************************************************************/
+void Acq_Service(void) {
+    unsigned int filled;
+    unsigned int first;
+    unsigned int skipped;
+
+    while (acqContinuous && (filled = acqBlocksFilled) != acqBlocksDone) {
+        skipped = 0;
+        if (filled - acqBlocksDone >= acqBlocks) {
+            skipped = filled - 1 - acqBlocksDone;
+            acqBlocksDone = filled - 1;     // only the newest block is still whole
+            acqDoneOfs = (acqBlocksDone % acqBlocks) * blockSize;
+        }
+        first = acqDoneOfs;
+        acqDoneOfs += blockSize;
+        if (acqDoneOfs >= acqRing)
+            acqDoneOfs = 0;
+        acqBlocksDone++;
+
+        if (sysMode == 2) {
+            if (filtMem) {
+                Filt_Block(0, &buffer0[first], blockSize, dcLevel[0] >> DC_FRAC);
+                if (buffer1)
+                    Filt_Block(1, &buffer1[first], blockSize, dcLevel[1] >> DC_FRAC);
+            }
+            if (xcLags && buffer1
+                && Xc_Step(&buffer0[first], &buffer1[first],
+                           (blockSize > XC_BLOCK_SAMPLES) ? XC_BLOCK_SAMPLES : blockSize,
+                           dcLevel[0] >> DC_FRAC, dcLevel[1] >> DC_FRAC, XC_BLOCK_LAGS,
+                           &xcDelay, &xcPeak) == ERR_VALUE)
+                xcPeak = 0;
+            Data_Process(first, blockSize);
+            if (decOut)
+                Dec_Block(first, blockSize);
+            if (logStat)
+                Log_Block(first, blockSize);
+            if (gzMem)
+                Gz_Block(procOut, first, blockSize, acqRing, dcLevel[0] >> DC_FRAC);
+            if (envMem)
+                Env_Block(procOut, first, blockSize, dcLevel[0] >> DC_FRAC);
+            if (freqHyst) {
+                Freq_Block(procOut, first, blockSize);
+                if (first + blockSize >= acqRing
+                    && (Freq_Periods() >= 2 || ++freqLaps >= FREQ_MAX_LAPS)) {
+                    freqCentiHz = Freq_Result(SAMPLE_HZ, &freqConf);
+                    freqLaps = 0;
+                }
+            }
+        }
+        if (packed0)
+            Rec_Block(first, blockSize);
+        if (sysMode == 1 && (trigState == TRIG_ARMED || trigState == TRIG_FIRED))
+            Trig_Block(first, blockSize, skipped);  // may stop capture
+    }
 }
 
-// @brief will send a string over UART
-int fputs(const char *_ptr, register FILE *_fp) {
-    unsigned int i, len;
+/***************************************************************************************
+ * Function: Rec_Block()                                                               *
+ * Input Parameters: first, count - half of the staging buffers to keep                *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Appends one staging half of each region to its packed record. The              *
+ *      records are rings, so they always hold the newest recSamples samples.          *
+ *      The stage record is only written while processing. Without a stage             *
+ *      buffer1 holds results while processing, so its record does too.               *
+ ***************************************************************************************/
+void Rec_Block(unsigned int first, unsigned int count) {
+    Pack12_Write(packed0, recPos, &buffer0[first], count);
+    if (packed1)
+        Pack12_Write(packed1, recPos, &buffer1[first], count);
+    if (packed2 && sysMode == 2)
+        Pack12_Write(packed2, recPos, &buffer2[first], count);
 
-    // Length of string
-    len = strlen(_ptr);
+    recPos += count;
+    if (recPos >= recSamples)
+        recPos = 0;
+    if (recFilled < recSamples)
+        recFilled += count;
+}
 
-    // loop until i equals length of string
-    for (i = 0; i < len; i++) {
-        // hold until register UC1IFG matches
-        // UCA1TXIFG register
-        while (!(UC1IFG & UCA1TXIFG))
-            ;
+/***************************************************************************************
+ * Function: Trig_Window()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: samples per channel kept by a triggered capture                             *
+ * Description:                                                                        *
+ *      main() stops DMA only after the block holding the last post-trigger            *
+ *      sample is serviced, by when DMA has moved into the next block and has          *
+ *      the one after that loaded. Those two blocks are never part of the window.      *
+ ***************************************************************************************/
+unsigned int Trig_Window(void) {
+    return (numResults / TRIG_BLOCKS) * (TRIG_BLOCKS - 2);
+}
 
-        // add each a single char from string to
-        // Transmission buffer
-        UCA1TXBUF = (unsigned char) _ptr[i];
+/***************************************************************************************
+ * Function: Trig_Pre()                                                                *
+ * Input Parameters: NONE                                                              *
+ * Output: samples before the trigger in the frozen capture, or that the next          *
+ *         capture keeps                                                               *
+ * Description:                                                                        *
+ *      Trig_Window() - 1 - trigPost, less any oldest samples Trig_Freeze() found      *
+ *      overwritten.                                                                   *
+ ***************************************************************************************/
+unsigned int Trig_Pre(void) {
+    if (trigState == TRIG_DONE)
+        return (trigIndex + acqRing - trigStart) % acqRing;
+    return Trig_Window() - 1 - trigPost;
+}
+
+/***************************************************************************************
+ * Function: Trig_Arm()                                                                *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Starts the pre-trigger ring: capture runs continuously over TRIG_BLOCKS        *
+ *      blocks and each completed block is scanned for the trigger.                    *
+ ***************************************************************************************/
+void Trig_Arm(void) {
+    Acq_Start(TRIG_BLOCKS);
+    trigPrev = (trigType == TRIG_FALLING) ? 0 : 0xFFFF; // no crossing on sample 0
+    trigState = TRIG_ARMED;
+}
+
+/***************************************************************************************
+ * Function: Trig_Scan()                                                               *
+ * Input Parameters: prev  - sample before p[0]                                        *
+ *                   p     - completed block of the trigger channel                    *
+ *                   count - samples in the block                                      *
+ * Output: index of the first sample meeting the trigger, or -1                        *
+ * Description:                                                                        *
+ *      One tight loop per trigger type, through a non-volatile pointer since          *
+ *      DMA is writing another block. A few cycles per sample, far below the           *
+ *      adcRate cycles between samples.                                                *
+ ***************************************************************************************/
+int Trig_Scan(unsigned int prev, const unsigned int *p, unsigned int count) {
+    unsigned int i;
+    unsigned int level = trigLevel;
+    int step = trigLevel;
+
+    switch (trigType) {
+    case TRIG_RISING:
+        for (i = 0; i < count; prev = p[i++])
+            if (prev < level && p[i] >= level)
+                return i;
+        break;
+    case TRIG_FALLING:
+        for (i = 0; i < count; prev = p[i++])
+            if (prev > level && p[i] <= level)
+                return i;
+        break;
+    case TRIG_SLOPE:
+        if (prev == 0xFFFF)
+            prev = p[0];            // first block: no step into sample 0
+        if (step >= 0) {
+            for (i = 0; i < count; prev = p[i++])
+                if ((int) (p[i] - prev) >= step)
+                    return i;
+        } else {
+            for (i = 0; i < count; prev = p[i++])
+                if ((int) (p[i] - prev) <= step)
+                    return i;
+        }
+        break;
+    default:
+        break;
     }
+    return -1;
+}
 
-    // return length of string
-    return (len);
+/***************************************************************************************
+ * Function: Trig_Block()                                                              *
+ * Input Parameters: first, count - block of the ring that just completed              *
+ *                   skipped      - blocks before it that DMA lapped unserviced        *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Scans for the trigger while armed, then counts post-trigger samples and        *
+ *      freezes the ring once trigPost of them have been captured. Skipped blocks      *
+ *      are not scanned but count as captured. A trigger is only taken once the        *
+ *      ring holds the pre-trigger samples since Trig_Arm(), so the window never       *
+ *      starts with samples of an earlier capture.                                     *
+ ***************************************************************************************/
+void Trig_Block(unsigned int first, unsigned int count, unsigned int skipped) {
+    const unsigned int *p = (const unsigned int *) ((trigChannel ? buffer1 : buffer0) + first);
+    unsigned int held = acqBlocksDone - 1;      // blocks captured before this one
+    unsigned int pre = Trig_Window() - 1 - trigPost;
+    unsigned int fill = 0;
+    int hit;
+
+    if (trigState == TRIG_ARMED) {
+        if (skipped)
+            trigPrev = (trigType == TRIG_FALLING) ? 0 : 0xFFFF; // p[-1] was not scanned
+        if (held < TRIG_BLOCKS && held * count < pre) {
+            fill = pre - held * count;  // still filling the pre-trigger samples
+            if (fill >= count) {
+                trigPrev = p[count - 1];
+                return;
+            }
+            trigPrev = p[fill - 1];
+        }
+        hit = Trig_Scan(trigPrev, p + fill, count - fill);
+        trigPrev = p[count - 1];
+        if (hit < 0)
+            return;
+        hit += fill;
+        trigIndex = first + hit;
+        trigLeft = (int) trigPost - (int) (count - 1 - hit);
+        trigState = TRIG_FIRED;
+    } else {
+        trigLeft -= (int) (count * (skipped + 1));
+    }
+    if (trigLeft <= 0)
+        Trig_Freeze();
+}
+
+/***************************************************************************************
+ * Function: Trig_Freeze()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Stops capture and works out where the kept window starts: it ends with         *
+ *      the last post-trigger sample and is Trig_Window() samples long. When           *
+ *      lapped blocks ran the capture more than a block past that sample, DMA          *
+ *      has overwritten the oldest samples of the window and it starts later           *
+ *      (Trig_Pre() says where the trigger is). If that reaches the trigger, or        *
+ *      the capture is one of an average or an equivalent-time run, it is              *
+ *      dropped and the trigger re-armed.                                              *
+ ***************************************************************************************/
+void Trig_Freeze(void) {
+    unsigned int last, newer, stale;
+
+    ADC12CTL0 &= ~ENC;
+    DMA0CTL &= ~DMAEN;
+    DMA1CTL &= ~DMAEN;
+    DMA2CTL &= ~DMAEN;
+    acqContinuous = 0;
+
+    // samples captured after the last post-trigger one
+    newer = (unsigned int) -trigLeft + (acqBlocksFilled - acqBlocksDone) * blockSize;
+    stale = (newer > blockSize) ? newer - blockSize : 0;
+    if (stale && (stale >= Trig_Window() - trigPost || etsWave || avgSum)) {
+        if (etsWave)
+            Ets_Arm();
+        else
+            Trig_Arm();
+        return;
+    }
+    acqFrozen = 1;
+    trigState = TRIG_DONE;
+
+    last = (trigIndex + trigPost) % acqRing;
+    trigStart = (last + 1 + acqRing - (Trig_Window() - stale)) % acqRing;
+    if (etsWave)
+        Ets_Add();
+    else if (avgSum)
+        Avg_Add();
+}
+
+/***************************************************************************************
+ * Function: Avg_Config()                                                              *
+ * Input Parameters: shift - log2 of the captures to average, 0 to stop averaging      *
+ * Output: ERR_OK, or ERR_VALUE if shift is too large, the sum does not fit or         *
+ *         equivalent-time sampling holds the trigger                                  *
+ * Description:                                                                        *
+ *      Takes a 32-bit running sum of Trig_Window() samples from the arena, above      *
+ *      the capture regions, or gives it back.                                         *
+ ***************************************************************************************/
+int Avg_Config(unsigned int shift) {
+    Stage_Free(STAGE_AVG);
+    avgSum = 0;
+    avgShift = 0;
+    if (shift == 0)
+        return ERR_OK;
+    if (shift > AVG_MAX_SHIFT || etsWave)
+        return ERR_VALUE;
+
+    avgSum = Stage_Alloc(STAGE_AVG, Trig_Window() * sizeof(long));
+    if (!avgSum)
+        return ERR_VALUE;
+    avgShift = shift;
+    avgCount = 0;
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Avg_Start()                                                               *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Clears the running sum and arms the trigger for the first capture.             *
+ ***************************************************************************************/
+void Avg_Start(void) {
+    unsigned int i;
+
+    for (i = 0; i < Trig_Window(); i++)
+        avgSum[i] = 0;
+    avgCount = 0;
+    Trig_Arm();
+}
+
+/***************************************************************************************
+ * Function: Avg_Add()                                                                 *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Adds the frozen window of the trigger channel to the running sum. Every        *
+ *      capture has the trigger at the same window index, so the repetitive            *
+ *      signal adds coherently and the noise by sqrt(K). The trigger is re-armed       *
+ *      until 2^avgShift captures are in, then the ring stays frozen.                  *
+ ***************************************************************************************/
+void Avg_Add(void) {
+    const unsigned int *p = (const unsigned int *) (trigChannel ? buffer1 : buffer0);
+    unsigned long *sum = avgSum;
+    unsigned int n = Trig_Window();
+    unsigned int j = trigStart;
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        sum[i] += p[j];
+        if (++j == acqRing)
+            j = 0;
+    }
+    if (++avgCount < (1U << avgShift))
+        Trig_Arm();
+}
+
+/***************************************************************************************
+ * Function: Ets_Config()                                                              *
+ * Input Parameters: samples - real samples kept after each trigger, 0 to stop         *
+ *                   slots   - equivalent-time points per sample period, 2..ETS_MAX_SLOTS *
+ * Output: ERR_OK, or ERR_VALUE if the settings are invalid, do not fit, averaging     *
+ *         holds the trigger or the trigger is not a level crossing                    *
+ * Description:                                                                        *
+ *      Takes the samples * slots waveform from the arena, above the capture           *
+ *      regions, or gives it back. Ets_Add() places repetitions by where the           *
+ *      signal crossed trigLevel, so only TRIG_RISING and TRIG_FALLING can run.        *
+ ***************************************************************************************/
+int Ets_Config(unsigned int samples, unsigned int slots) {
+    Stage_Free(STAGE_ETS);
+    etsWave = 0;
+    etsSamples = 0;
+    if (samples == 0)
+        return ERR_OK;
+    if (slots < 2 || slots > ETS_MAX_SLOTS || samples >= Trig_Window() || avgSum
+        || (trigType != TRIG_RISING && trigType != TRIG_FALLING))
+        return ERR_VALUE;
+
+    etsWave = Stage_Alloc(STAGE_ETS, samples * slots * sizeof(int));
+    if (!etsWave)
+        return ERR_VALUE;
+    etsSamples = samples;
+    etsSlots = slots;
+    if (trigPost < samples)
+        trigPost = samples;         // every kept sample must be captured
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Ets_Start()                                                               *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Empties the waveform and arms the trigger for the first repetition.            *
+ ***************************************************************************************/
+void Ets_Start(void) {
+    unsigned int i;
+
+    for (i = 0; i < etsSamples * etsSlots; i++)
+        etsWave[i] = ETS_EMPTY;
+    etsReps = 0;
+    etsFilled = 0;
+    Ets_Arm();
+}
+
+/***************************************************************************************
+ * Function: Ets_Arm()                                                                 *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Moves the ADC trigger (Timer B OUT1 edge at TBCCR1) by adcRate/etsSlots        *
+ *      cycles for the next repetition and arms the trigger. The edge must stay        *
+ *      inside the Timer B period, TBCCR1 in 1..TBCCR0-1, so phase 0 is moved to       *
+ *      1 and the last count (adcRate - 1 = TBCCR0) to the one before it.              *
+ ***************************************************************************************/
+void Ets_Arm(void) {
+    unsigned int phase;
+
+    phase = ((adcRate >> 1) + (etsReps % etsSlots) * (adcRate / etsSlots)) % adcRate;
+    if (phase == 0)
+        phase = 1;
+    else if (phase > adcRate - 2)
+        phase = adcRate - 2;
+    TBCCR1 = phase;
+    Trig_Arm();
+}
+
+/***************************************************************************************
+ * Function: Ets_Add()                                                                 *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Places one frozen repetition into the waveform. The trigger crossing is        *
+ *      located between the two samples that straddle trigLevel by linear              *
+ *      interpolation, to 1/etsSlots of a sample period. Sample k after the            *
+ *      crossing then lands in slot k * etsSlots + offset. The TBCCR1 step makes       *
+ *      sure signals locked to SMCLK still land in every slot. A repetition whose      *
+ *      two samples do not straddle the level the way trigType says (so b == a         *
+ *      cannot reach the divide) is dropped. Re-arms until every slot holds a          *
+ *      value or ETS_MAX_REPS repetitions per slot were tried.                         *
+ ***************************************************************************************/
+void Ets_Add(void) {
+    const unsigned int *p = (const unsigned int *) (trigChannel ? buffer1 : buffer0);
+    unsigned int slots = etsSlots;
+    unsigned int total = etsSamples * slots;
+    unsigned int j = trigIndex;
+    int a = p[j ? j - 1 : acqRing - 1];
+    int b = p[j];
+    unsigned int pos;
+
+    // crossing at (level - a) / (b - a) of the period before sample b
+    if ((trigType == TRIG_RISING && a < trigLevel && b >= trigLevel)
+        || (trigType == TRIG_FALLING && a > trigLevel && b <= trigLevel))
+        pos = slots - (unsigned int) (((long) (trigLevel - a) * slots + ((b - a) >> 1))
+                                      / (b - a));
+    else
+        pos = total;                // no crossing to place it by
+
+    for (; pos < total; pos += slots) {
+        if (etsWave[pos] == ETS_EMPTY)
+            etsFilled++;
+        etsWave[pos] = p[j];
+        if (++j == acqRing)
+            j = 0;
+    }
+
+    if (etsFilled < total && ++etsReps < ETS_MAX_REPS * slots) {
+        Ets_Arm();
+        return;
+    }
+    TBCCR1 = (adcRate >> 1);        // waveform done, frozen for UART
+}
+
+/***************************************************************************************
+ * Function: Dec_Config()                                                              *
+ * Input Parameters: shift   - log2 of the decimation ratio, 0 to stop decimating      *
+ *                   samples - decimated samples kept                                  *
+ * Output: ERR_OK, or ERR_VALUE if the settings are invalid or do not fit              *
+ * Description:                                                                        *
+ *      Takes the decimated record from the arena, above the capture regions.          *
+ ***************************************************************************************/
+int Dec_Config(unsigned int shift, unsigned int samples) {
+    Stage_Free(STAGE_DEC);
+    decOut = 0;
+    decShift = 0;
+    if (shift == 0)
+        return ERR_OK;
+    if (shift > DEC_MAX_SHIFT || samples == 0)
+        return ERR_VALUE;
+
+    decOut = Stage_Alloc(STAGE_DEC, samples * sizeof(int));
+    if (!decOut)
+        return ERR_VALUE;
+    decShift = shift;
+    decSamples = samples;
+    Dec_Reset();
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Dec_Reset()                                                               *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Empties the record and starts a new integrate-and-dump period.                 *
+ ***************************************************************************************/
+void Dec_Reset(void) {
+    decAcc = 0;
+    decLeft = 1U << decShift;
+    decPos = 0;
+    decFilled = 0;
+}
+
+/***************************************************************************************
+ * Function: Dec_Block()                                                               *
+ * Input Parameters: first, count - block of procOut that was just processed           *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      First-order CIC (integrate and dump): every 2^decShift results are summed      *
+ *      and the sum is kept with decShift/2 extra bits, so the output has              *
+ *      12 + decShift/2 bits (13 at a ratio of 4, 16 at 256). Only adds and            *
+ *      shifts, about 10 cycles per input sample.                                      *
+ ***************************************************************************************/
+void Dec_Block(unsigned int first, unsigned int count) {
+    const unsigned int *p = (const unsigned int *) procOut + first;
+    unsigned long acc = decAcc;
+    unsigned int left = decLeft;
+    unsigned int drop = decShift - (decShift >> 1);
+
+    while (count--) {
+        acc += *p++;
+        if (--left == 0) {
+            decOut[decPos] = (unsigned int) (acc >> drop);
+            if (++decPos == decSamples)
+                decPos = 0;
+            if (decFilled < decSamples)
+                decFilled++;
+            acc = 0;
+            left = 1U << decShift;
+        }
+    }
+    decAcc = acc;
+    decLeft = left;
+}
+
+/***************************************************************************************
+ * Function: Log_Config()                                                              *
+ * Input Parameters: ratio  - decimation ratio of each stage, first stage first        *
+ *                   stages - number of stages, 0 to stop logging                      *
+ * Output: ERR_OK, or ERR_VALUE if a ratio is 0 or the log does not fit                *
+ * Description:                                                                        *
+ *      Takes the stage state and the LOG_RING record ring from the arena, above       *
+ *      the capture regions, as one region. RAM use does not change while the log      *
+ *      runs.                                                                          *
+ *      Ratios whose product is the sample rate log one record per second: at          *
+ *      the SAMPLE_RATE of reset (50k), 'L 50 100 10'; after 'R', SAMPLE_HZ.           *
+ ***************************************************************************************/
+int Log_Config(const unsigned int *ratio, unsigned int stages) {
+    unsigned int k;
+
+    Stage_Free(STAGE_LOG);
+    logStat = 0;
+    logRing = 0;
+    logStages = 0;
+    if (stages == 0)
+        return ERR_OK;
+    for (k = 0; k < stages; k++)
+        if (ratio[k] == 0)
+            return ERR_VALUE;
+
+    logStat = Stage_Alloc(STAGE_LOG, stages * sizeof(struct LogStat)
+                                     + LOG_RING * sizeof(struct LogRec));
+    if (!logStat)
+        return ERR_VALUE;
+    logRing = (struct LogRec *) (logStat + stages);
+    for (k = 0; k < stages; k++)
+        logStat[k].ratio = ratio[k];
+    logStages = stages;
+    logHead = 0;
+    logCount = 0;
+    logSeq = 0;
+    logDropped = 0;
+    Log_Restart();
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Log_Restart()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Drops the partial period of every stage, capture restarted with a gap.         *
+ *      Records already in the ring are kept.                                          *
+ ***************************************************************************************/
+void Log_Restart(void) {
+    unsigned int k;
+
+    for (k = 0; k < logStages; k++) {
+        logStat[k].min = 0xFFFF;
+        logStat[k].max = 0;
+        logStat[k].sum = 0;
+        logStat[k].count = 0;
+    }
+}
+
+/***************************************************************************************
+ * Function: Log_Input()                                                               *
+ * Input Parameters: k - stage receiving the record                                    *
+ *                   min, max, mean - record from stage k - 1                          *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Folds one record into stage k: min of the minima, max of the maxima and        *
+ *      mean of the means. Completed periods ripple up; the last stage stores          *
+ *      its records in the ring, overwriting the oldest when it is not drained.        *
+ ***************************************************************************************/
+void Log_Input(unsigned int k, unsigned int min, unsigned int max, unsigned int mean) {
+    struct LogStat *st;
+    struct LogRec *rec;
+
+    for (; k < logStages; k++) {
+        st = &logStat[k];
+        if (min < st->min)
+            st->min = min;
+        if (max > st->max)
+            st->max = max;
+        st->sum += mean;
+        if (++st->count < st->ratio)
+            return;
+
+        min = st->min;
+        max = st->max;
+        mean = (unsigned int) (st->sum / st->count);
+        st->min = 0xFFFF;
+        st->max = 0;
+        st->sum = 0;
+        st->count = 0;
+    }
+
+    rec = &logRing[logHead];
+    rec->min = min;
+    rec->max = max;
+    rec->mean = mean;
+    if (++logHead == LOG_RING)
+        logHead = 0;
+    if (logCount < LOG_RING)
+        logCount++;
+    else
+        logDropped++;
+    logSeq++;
+}
+
+/***************************************************************************************
+ * Function: Log_Block()                                                               *
+ * Input Parameters: first, count - block of procOut that was just processed           *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      First stage, run on every raw result: a compare pair and a 32-bit add          *
+ *      per sample. Each full period is handed to the next stage.                      *
+ ***************************************************************************************/
+void Log_Block(unsigned int first, unsigned int count) {
+    const unsigned int *p = (const unsigned int *) procOut + first;
+    struct LogStat *st = &logStat[0];
+    unsigned int x;
+
+    while (count--) {
+        x = *p++;
+        if (x < st->min)
+            st->min = x;
+        if (x > st->max)
+            st->max = x;
+        st->sum += x;
+        if (++st->count == st->ratio) {
+            x = (unsigned int) (st->sum / st->count);
+            Log_Input(1, st->min, st->max, x);
+            st->min = 0xFFFF;
+            st->max = 0;
+            st->sum = 0;
+            st->count = 0;
+        }
+    }
+}
+
+/***************************************************************************************
+ * Function: Log_Drain()                                                               *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Sends and removes every record in the ring as "seq,min,max,mean". A gap        *
+ *      in seq means records were overwritten. Capture keeps being serviced            *
+ *      between lines, one line takes well under a ping-pong half.                     *
+ ***************************************************************************************/
+void Log_Drain(void) {
+    struct LogRec rec;
+    unsigned long seq;
+    unsigned int tail;
+
+    while (logCount) {
+        tail = (logHead + LOG_RING - logCount) % LOG_RING;
+        rec = logRing[tail];
+        seq = logSeq - logCount;
+        logCount--;
+        printf("%lu,%u,%u,%u\r\n", seq, rec.min, rec.max, rec.mean);
+        if (acqContinuous)
+            Acq_Service();
+    }
+}
+
+/***************************************************************************************
+ * Function: Proc_Cycles()                                                             *
+ * Input Parameters: taps     - NLMS taps, 0 for the subtraction                       *
+ *                   channels - capture channels, 1 or 2                               *
+ *                   packs    - regions recorded packed, 0 = not packed                *
+ * Output: estimated MCLK cycles per sample of processing mode                         *
+ * Description:                                                                        *
+ *      The path Data_Process() takes with the skew and statistics now set: the        *
+ *      copy of a single channel, the canceller, Krn_Sub() with no skew and no         *
+ *      statistics, or the interpolating loop otherwise (the default, since A1         *
+ *      converts after A2). Statistics, the channel filters and the packed             *
+ *      records are added. Counts from the instructions, not measurements; every       *
+ *      setting that changes one is checked against PROC_CYCLES with it.               *
+ ***************************************************************************************/
+unsigned int Proc_Cycles(unsigned int taps, unsigned int channels, unsigned int packs) {
+    unsigned int cycles = filtMem ? Filt_Cycles() : 0;
+
+    if (channels < 2)
+        cycles += SUB_CYCLES;       // a copy, at most
+    else if (taps)
+        cycles += NLMS_CYCLES(taps);
+    else if (skewFrac || statsOn)
+        cycles += SKEW_CYCLES;
+    else
+        cycles += SUB_CYCLES;
+    if (statsOn)
+        cycles += STATS_CYCLES;
+    if (packs)
+        cycles += PACK_CYCLES(packs);
+    return cycles;
+}
+
+/***************************************************************************************
+ * Function: Nlms_Config()                                                             *
+ * Input Parameters: taps    - filter length, 0 to go back to plain subtraction        *
+ *                   muShift - step size 2^-muShift                                    *
+ * Output: ERR_OK, or ERR_VALUE if the settings are invalid, do not fit or are too     *
+ *         slow for the sample period                                                  *
+ * Description:                                                                        *
+ *      Takes the weights and history from the arena, above the capture regions.       *
+ *      Tap counts whose estimated cost (Proc_Cycles), with the channel filters,       *
+ *      exceeds PROC_CYCLES would overrun in processing mode and are refused: at       *
+ *      most 8 at the 160-cycle default period (142 cycles of 152), 3 with             *
+ *      statistics on. The canceller replaces the skew correction, which is not        *
+ *      charged with it.                                                               *
+ ***************************************************************************************/
+int Nlms_Config(unsigned int taps, unsigned int muShift) {
+    Stage_Free(STAGE_NLMS);
+    nlmsMem = 0;
+    nlmsTaps = 0;
+    if (taps == 0)
+        return ERR_OK;
+    if (taps > NLMS_MAX_TAPS || Proc_Cycles(taps, capChannels, recRegions) > PROC_CYCLES
+        || muShift > 15 || !buffer1)
+        return ERR_VALUE;
+
+    nlmsMem = Stage_Alloc(STAGE_NLMS, NLMS_BYTES(taps));
+    if (!nlmsMem)
+        return ERR_VALUE;
+    nlmsTaps = taps;
+    nlmsMuShift = muShift;
+    Nlms_Init(nlmsMem, taps, muShift);
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Fft_Config()                                                              *
+ * Input Parameters: points - FFT size, a power of two from FFT_MIN_POINTS to          *
+ *                            FFT_MAX_POINTS, 0 to send samples again                  *
+ * Output: ERR_OK, or ERR_VALUE if the size is invalid or does not fit                 *
+ * Description:                                                                        *
+ *      Takes the work buffer from the arena, above the capture regions. The           *
+ *      spectrum is of procOut, so records must not be packed.                         *
+ ***************************************************************************************/
+int Fft_Config(unsigned int points) {
+    Stage_Free(STAGE_FFT);
+    fftBuf = 0;
+    fftPoints = 0;
+    if (points == 0)
+        return ERR_OK;
+    if (points < FFT_MIN_POINTS || points > FFT_MAX_POINTS || (points & (points - 1))
+        || points > numResults || packed0)
+        return ERR_VALUE;
+
+    fftBuf = Stage_Alloc(STAGE_FFT, points * sizeof(int));
+    if (!fftBuf)
+        return ERR_VALUE;
+    fftPoints = points;
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Gz_Config()                                                               *
+ * Input Parameters: shift - Goertzel inputs are averages of 2^shift results           *
+ *                   len   - averaged inputs per amplitude and phase, 0 to stop        *
+ * Output: ERR_OK, or ERR_VALUE if the settings are invalid or do not fit              *
+ * Description:                                                                        *
+ *      Takes room for a full bank from the arena, above the capture regions, and      *
+ *      starts it empty. Bins are added with Gz_Add().                                 *
+ ***************************************************************************************/
+int Gz_Config(unsigned int shift, unsigned int len) {
+    Stage_Free(STAGE_GZ);
+    gzMem = 0;
+    if (len == 0)
+        return ERR_OK;
+    if (shift > GZ_MAX_SHIFT || len > GZ_MAX_LEN)
+        return ERR_VALUE;
+
+    gzMem = Stage_Alloc(STAGE_GZ, GZ_BYTES);
+    if (!gzMem)
+        return ERR_VALUE;
+    Gz_Init(gzMem, shift, len);
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Filt_Config()                                                             *
+ * Input Parameters: ch     - channel, 0 = A2, 1 = A1                                  *
+ *                   design - filter design in filter.c or FILT_USER, 0 = off          *
+ * Output: ERR_OK, or ERR_VALUE if the settings are invalid, do not fit or are too     *
+ *         slow for the sample period                                                  *
+ * Description:                                                                        *
+ *      Takes the state of both channels from the arena, above the capture             *
+ *      regions, for the first channel filtered, and gives it back once neither        *
+ *      is. A design whose estimated cost (Filt_Cycles), next to the subtraction       *
+ *      or the NLMS canceller (Proc_Cycles), exceeds PROC_CYCLES would overrun in      *
+ *      processing mode; the channel keeps its previous design instead. filter.c       *
+ *      lists the Timer B period ('R') each built-in design needs.                     *
+ ***************************************************************************************/
+int Filt_Config(unsigned int ch, unsigned int design) {
+    unsigned int old;
+    int err = ERR_OK;
+
+    if (ch >= FILT_CHANNELS)
+        return ERR_VALUE;
+    if (!filtMem) {
+        if (design == 0)
+            return ERR_OK;
+        filtMem = Stage_Alloc(STAGE_FILT, FILT_BYTES);
+        if (!filtMem)
+            return ERR_VALUE;
+        Filt_Init(filtMem);
+    }
+    old = Filt_Design(ch);
+    if (Filt_Select(ch, design) != 0) {
+        err = ERR_VALUE;
+    } else if (Proc_Cycles(nlmsTaps, capChannels, recRegions) > PROC_CYCLES) {
+        Filt_Select(ch, old);
+        err = ERR_VALUE;
+    }
+    if (Filt_Design(0) == 0 && Filt_Design(1) == 0) {
+        Stage_Free(STAGE_FILT);
+        filtMem = 0;
+    }
+    return err;
+}
+
+/***************************************************************************************
+ * Function: Env_Config()                                                              *
+ * Input Parameters: shift  - RMS window of 2^shift results, 0 = off                   *
+ *                   smooth - envelope weight 2^-smooth per point                      *
+ *                   decim  - results per point                                        *
+ * Output: ERR_OK, or ERR_VALUE if the settings are invalid or do not fit              *
+ * Description:                                                                        *
+ *      Takes the window and the point ring from the arena, above the capture          *
+ *      regions.                                                                       *
+ ***************************************************************************************/
+int Env_Config(unsigned int shift, unsigned int smooth, unsigned int decim) {
+    Stage_Free(STAGE_ENV);
+    envMem = 0;
+    envShift = 0;
+    if (shift == 0)
+        return ERR_OK;
+    if (shift > ENV_MAX_SHIFT || smooth > ENV_MAX_SMOOTH || decim == 0)
+        return ERR_VALUE;
+
+    envMem = Stage_Alloc(STAGE_ENV, ENV_BYTES(shift));
+    if (!envMem)
+        return ERR_VALUE;
+    envShift = shift;
+    Env_Init(envMem, shift, smooth, decim);
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Stage_Alloc()                                                             *
+ * Input Parameters: stage - STAGE_xxx, not holding a region                           *
+ *                   bytes - size of its region                                        *
+ * Output: word-aligned region, or 0 if it does not fit                                *
+ * Description:                                                                        *
+ *      Averaging, equivalent-time sampling, decimation, logging, the NLMS             *
+ *      canceller, the spectrum, the Goertzel bank, the channel filters and the        *
+ *      envelope detector each take their own region from the arena above the          *
+ *      capture regions, so any mix of them runs as long as the sum fits.              *
+ ***************************************************************************************/
+void *Stage_Alloc(unsigned int stage, unsigned int bytes) {
+    void *p = Arena_Alloc(bytes);
+
+    if (p)
+        stageEnd[stage] = Arena_Mark();
+    return p;
+}
+
+/***************************************************************************************
+ * Function: Stage_Free()                                                              *
+ * Input Parameters: stage - STAGE_xxx                                                 *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Gives back the stage's region by releasing the arena down to the highest       *
+ *      region still held. A region below one still held stays a hole until that       *
+ *      one goes as well (last in, first out), so the free count only grows when       *
+ *      the top region is given back. The caller clears the stage's pointers.          *
+ ***************************************************************************************/
+void Stage_Free(unsigned int stage) {
+    unsigned int top = stageBase;
+    unsigned int k;
+
+    stageEnd[stage] = 0;
+    for (k = 0; k < STAGES; k++)
+        if (stageEnd[k] > top)
+            top = stageEnd[k];
+    Arena_Release(top);
+}
+
+/***************************************************************************************
+ * Function: Scratch_Free()                                                            *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Gives back every stage region and turns all the stages off, before the         *
+ *      capture regions are split again.                                               *
+ ***************************************************************************************/
+void Scratch_Free(void) {
+    unsigned int k;
+
+    for (k = 0; k < STAGES; k++)
+        stageEnd[k] = 0;
+    Arena_Release(stageBase);
+    avgSum = 0;
+    avgShift = 0;
+    etsWave = 0;
+    etsSamples = 0;
+    decOut = 0;
+    decShift = 0;
+    logStat = 0;
+    logRing = 0;
+    logStages = 0;
+    nlmsMem = 0;
+    nlmsTaps = 0;
+    fftBuf = 0;
+    fftPoints = 0;
+    gzMem = 0;
+    filtMem = 0;
+    envMem = 0;
+    envShift = 0;
+}
+
+/***************************************************************************************
+ * Function: Acq_Check()                                                               *
+ * Input Parameters: NONE                                                              *
+ * Output: number of samples lost since Acq_Start()                                    *
+ * Description:                                                                        *
+ *      Sample accounting for continuous capture. DMA_ISR counts every half that       *
+ *      DMA starts overwriting before Data_Process() released it, and every half       *
+ *      where the two channels fell out of step. Returns 0 when the run was            *
+ *      gap-free.                                                                      *
+ ***************************************************************************************/
+unsigned int Acq_Check(void) {
+    return (acqOverruns + acqDesync) * blockSize;
+}
+
+/***************************************************************************************
+ * Function: Hlth_Restart()                                                            *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Starts a new delivered-versus-expected and latency measurement, called         *
+ *      whenever DMA is re-armed. The ADC overflow counters run until 'H 0'.           *
+ ***************************************************************************************/
+void Hlth_Restart(void) {
+    unsigned short gie = __get_interrupt_state();   // also called before GIE is set
+
+    __disable_interrupt();
+    hlthSamples = 0;
+    hlthTicks = 0;
+    hlthLatMin = 0xFFFF;
+    hlthLatMax = 0;
+    __set_interrupt_state(gie);
+}
+
+/***************************************************************************************
+ * Function: Hlth_Report()                                                             *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Sends the health counters. Expected samples are the Timer B periods in         *
+ *      the Timer A ticks counted, so they are only good to one tick.                  *
+ *      Latency is from the TBCCR1 edge that starts a sequence to DMA_ISR for          *
+ *      the block it completed, and includes the conversions themselves; a value      *
+ *      near a full period means DMA_ISR is running late by a whole sample.            *
+ ***************************************************************************************/
+void Hlth_Report(void) {
+    unsigned long tickClks = (TACCR0 + 1UL) * 8;    // Timer A runs at SMCLK/8
+    unsigned int period = TBCCR0 + 1;
+    unsigned long ticks, samples, expected;
+
+    __disable_interrupt();
+    ticks = hlthTicks;
+    samples = hlthSamples;
+    __enable_interrupt();
+
+    // ticks * tickClks / period without overflowing 32 bits
+    expected = ticks * (tickClks / period) + ticks * (tickClks % period) / period;
+
+    printf("H ov %u tov %u samples %lu expected %lu lost %u lat %u %u\r\n",
+           hlthAdcOv, hlthAdcTov, samples, expected, Acq_Check(),
+           hlthLatMin, hlthLatMax);
+}
+
+/***************************************************************************************
+ * Function: Ilv_Start()                                                               *
+ * Input Parameters: channels - number of analog inputs, 2..ILV_MAX_CHANNELS           *
+ * Output: ERR_OK, or ERR_VALUE if channels is out of range or records are packed      *
+ * Description:                                                                        *
+ *      Captures several inputs with DMA0 alone. The ADC12 converts the inputs         *
+ *      listed in ilvInputs[] as one sequence (ADC12MCTL0..channels-1) per Timer B     *
+ *      period, and DMA0 moves the whole ADC12MEMx block into the next frame of        *
+ *      the ring on each sequence. The ring spans all channel regions of the           *
+ *      capture (they are adjacent in the arena) and starts at buffer0. Frames         *
+ *      are stored back to back, so sample i of channel ch is at                       *
+ *      buffer0[i * channels + ch]. DMA1 and DMA2 are left free.                       *
+ *      Timer B is slowed down if the sequence cannot finish in adcRate cycles.        *
+ ***************************************************************************************/
+int Ilv_Start(unsigned int channels) {
+    volatile unsigned char *mctl = &ADC12MCTL0;
+    unsigned int i;
+    unsigned int period;
+
+    if (channels < 2 || channels > ILV_MAX_CHANNELS || packed0)
+        return ERR_VALUE;
+
+    ADC12CTL0 &= ~ENC;
+    DMA0CTL &= ~DMAEN;
+    DMA1CTL &= ~DMAEN;
+    DMA2CTL &= ~DMAEN;
+
+    for (i = 0; i < channels; i++) {
+        mctl[i] = ilvInputs[i] + SREF_1;
+        P6SEL |= 1 << ilvInputs[i];
+    }
+    mctl[channels - 1] |= EOS;
+
+    period = channels * ILV_CYCLES_PER_CH * ADC12_DIV;
+    if (period < ILV_MIN_PERIOD)
+        period = ILV_MIN_PERIOD;
+    if (period < adcRate)
+        period = adcRate;
+    TBCCR0 = period - 1;
+    TBCCR1 = period >> 1;
+
+    ilvChannels = channels;
+    ilvFrames = (numResults * capChannels) / channels;
+    ilvEnd = &buffer0[ilvFrames * channels];
+    ilvFrame = 0;
+
+    // repeated block: every trigger copies ADC12MEM0..channels-1, then reloads
+    DMA0SA = (void (*)()) &ADC12MEM0;
+    DMA0DA = (void (*)()) &buffer0[0];
+    DMA0SZ = channels;
+    DMA0CTL = DMASRCINCR_3 + DMADSTINCR_3 + DMADT_5 + DMAIE + DMAEN;
+
+    // the first frame is latched by DMAEN, the reload picks up the second
+    ilvNext = &buffer0[channels];
+    DMA0DA = (void (*)()) ilvNext;
+
+    ilvActive = 1;
+    ADC12CTL0 |= ENC;
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Ilv_Stop()                                                                *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Restores the two-input, one-DMA-channel-per-input setup.                       *
+ ***************************************************************************************/
+void Ilv_Stop(void) {
+    ADC12CTL0 &= ~ENC;
+    DMA0CTL &= ~DMAEN;
+    ilvActive = 0;
+
+    P6SEL = BIT1 + BIT2;
+    TBCCR0 = adcRate - 1;
+    TBCCR1 = (adcRate >> 1);
+    InitADC();
+    InitDMA();
+}
+
+/***************************************************************************************
+ * Function: Ilv_Sample()                                                              *
+ * Input Parameters: ch - channel (ADC12MEMx index), frame - frame in the ring         *
+ * Output: 12-bit result                                                               *
+ * Description:                                                                        *
+ *      Reads one channel out of the interleaved buffer.                               *
+ ***************************************************************************************/
+unsigned int Ilv_Sample(unsigned int ch, unsigned int frame) {
+    return buffer0[frame * ilvChannels + ch];
+}
+
+/***************************************************************************************
+ * Function: Capture_Config()                                                          *
+ * Input Parameters: channels - 1 (A2) or 2 (A2, A1)                                   *
+ *                   samples  - samples per channel                                    *
+ *                   stages   - 0 to process in place over buffer1, 1 to keep the     *
+ *                              result in its own region (buffer2)                     *
+ *                   packed   - 1 to keep samples as packed 12-bit records             *
+ * Output: ERR_OK, or ERR_VALUE if the layout is invalid or does not fit               *
+ * Description:                                                                        *
+ *      Splits the sample arena into the capture regions. Unpacked, each region        *
+ *      is samples words that DMA writes directly (samples a multiple of               *
+ *      ACQ_BLOCKS). Packed, DMA writes 2*PACK_BLOCK-word staging rings and each       *
+ *      region gets a record of samples at 1.5 bytes each (samples a multiple of       *
+ *      PACK_BLOCK): up to 2240 each of A2 and A1, or 1440 with a stage. Packing       *
+ *      runs in the processing budget (Proc_Cycles), so a packed layout that           *
+ *      processing mode could not keep up with is refused: at the default period       *
+ *      two channels fit, a stage as well only with 'K 0'. A rejected layout           *
+ *      leaves the current one untouched. DMA must be stopped by the caller and        *
+ *      re-armed (InitDMA) afterwards.                                                 *
+ ***************************************************************************************/
+int Capture_Config(unsigned int channels, unsigned int samples, unsigned int stages,
+                   unsigned int packed) {
+    unsigned int regions = channels + stages;
+    unsigned int staged = packed ? 2 * PACK_BLOCK : samples;
+    unsigned long bytes;
+
+    if (channels < 1 || channels > 2 || stages > 1 || samples == 0)
+        return ERR_VALUE;
+    if (packed) {
+        if ((samples % PACK_BLOCK) != 0)
+            return ERR_VALUE;
+        bytes = regions * (2UL * staged + PACK12_BYTES(samples));
+        if (Proc_Cycles(nlmsTaps, channels, regions) > PROC_CYCLES)
+            return ERR_VALUE;
+    } else {
+        if ((samples % ACQ_BLOCKS) != 0)
+            return ERR_VALUE;
+        bytes = regions * 2UL * samples;
+    }
+    if (bytes > ARENA_BYTES)
+        return ERR_VALUE;
+
+    // channel regions first so they stay adjacent (interleaved ring)
+    Arena_Reset();
+    buffer0 = Arena_Alloc(staged * 2);
+    buffer1 = (channels > 1) ? Arena_Alloc(staged * 2) : 0;
+    buffer2 = stages ? Arena_Alloc(staged * 2) : 0;
+
+    packed0 = packed ? Arena_Alloc(PACK12_BYTES(samples)) : 0;
+    packed1 = (packed && buffer1) ? Arena_Alloc(PACK12_BYTES(samples)) : 0;
+    packed2 = (packed && buffer2) ? Arena_Alloc(PACK12_BYTES(samples)) : 0;
+    procOut = buffer2 ? buffer2 : (buffer1 ? buffer1 : buffer0);
+    packedOut = packed2 ? packed2 : (packed1 ? packed1 : packed0);
+    recSamples = packed ? samples : 0;
+    recRegions = packed ? regions : 0;
+    recPos = 0;
+    recFilled = 0;
+
+    numResults = staged;
+    capChannels = channels;
+    blockSize = staged / ACQ_BLOCKS;
+    stageBase = Arena_Mark();
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Cmd_Args()                                                                *
+ * Input Parameters: p - text after the command letter, args - output, max - size      *
+ * Output: number of values parsed                                                     *
+ * Description:                                                                        *
+ *      Parses up to max unsigned decimal values separated by spaces or commas.        *
+ ***************************************************************************************/
+unsigned int Cmd_Args(char *p, unsigned int *args, unsigned int max) {
+    unsigned int n = 0;
+    char *end;
+
+    while (n < max) {
+        while (*p == ' ' || *p == ',')
+            p++;
+        if (*p == 0)
+            break;
+        args[n] = (unsigned int) strtoul(p, &end, 10);
+        if (end == p)
+            break;
+        p = end;
+        n++;
+    }
+    return n;
+}
+
+/***************************************************************************************
+ * Function: Cmd_Process()                                                             *
+ * Input Parameters: line - command line from the host, without CR                     *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Runs one serial command:                                                       *
+ *        C                       report capture layout and free arena bytes           *
+ *        C ch samples stages [packed]                                                 *
+ *                                re-split the arena (rejected if it does not fit)     *
+ *        T                       report trigger state                                 *
+ *        T ch type level post    triggered capture in collect mode (type 0 = off);    *
+ *                                while E runs, type stays 1 or 2 and post at least    *
+ *                                E's samples                                          *
+ *        A [shift]               average 2^shift triggered captures (0 = off)         *
+ *        E [samples slots]       equivalent-time capture, samples * slots points,     *
+ *                                on a rising (1) or falling (2) trigger               *
+ *        D [shift [samples]]     decimate processed results by 2^shift (0 = off)      *
+ *        L                       send and empty the log ring                          *
+ *        L r0 [r1 [r2 [r3]]]     log processed results, stage ratios (L 0 = off)      *
+ *        K [frac]                A1-to-A2 skew in Q15 of a sample period (0 = off)    *
+ *        R [period]              Timer B period in SMCLK cycles, ADCRATE_MIN and up;  *
+ *                                standby only, not while Goertzel bins are set        *
+ *        H [0]                   report acquisition health, H 0 also clears it        *
+ *        N [taps [mu]]           NLMS canceller in processing mode (N 0 = off)        *
+ *        S [on]                  statistics of each processed capture (0 = off,       *
+ *                                2 = send them per capture), S alone reports them     *
+ *        F [hyst]                track the frequency of processed results (0 = off);  *
+ *                                F alone in standby measures the last A2 capture      *
+ *        P [points]              UART mode sends the magnitude spectrum (0 = off)     *
+ *        G [hz [hz [hz [hz]]]]   add Goertzel bins over processed results, G alone    *
+ *                                reports amplitude and phase (tenths of a degree)     *
+ *        G 0 [shift [len]]       empty bank averaging 2^shift results per input       *
+ *                                and len inputs per result; G 0 alone = off           *
+ *        B [ch design]           filter channel ch (0 = A2, 1 = A1) ahead of the      *
+ *                                processing with a design from filter.c (0 = off,     *
+ *                                7 = user); refused if it cannot keep up              *
+ *        B 2 type len            shape the user design: type 1 = len biquad           *
+ *                                sections, 2 = len FIR taps, 0 = none                 *
+ *        B 3 k c [c]             load user coefficients k (and k + 1)                 *
+ *        V                       send and empty the envelope points                   *
+ *        V shift [smooth [decim]]                                                     *
+ *                                envelope and RMS over 2^shift results of processed   *
+ *                                results, a point per decim (V 0 = off)               *
+ *        Z                       KRN_CHECK builds: compare the block kernels with     *
+ *                                their references, report errors and cycles/sample    *
+ *        I [channels]            collect and UART modes capture 2..8 inputs           *
+ *                                interleaved through DMA0 alone (0 = off, one DMA     *
+ *                                channel per input), ILV_CHANNELS at reset            *
+ *        X [lags]                delay of A1 behind A2 (hundredths of a sample) and   *
+ *                                correlation (thousandths) over +-lags, one lag per   *
+ *                                processed block (0 = off); X alone in standby        *
+ *                                measures the last capture if A1 has its own buffer   *
+ ***************************************************************************************/
+void Cmd_Process(char *line) {
+    unsigned int args[4];
+    unsigned int n = Cmd_Args(line + 1, args, 4);
+    unsigned int i;
+
+    switch (line[0]) {
+    case 'C':
+    case 'c':
+        if (n >= 3) {
+            if (acqContinuous)
+                Acq_Stop();
+            if (ilvActive)
+                Ilv_Stop();
+            ADC12CTL0 &= ~ENC;
+            DMA0CTL &= ~DMAEN;
+            DMA1CTL &= ~DMAEN;
+            DMA2CTL &= ~DMAEN;
+
+            Scratch_Free();
+            if (Capture_Config(args[0], args[1], args[2], n > 3 ? args[3] : 0) != ERR_OK)
+                printf("ERR\r\n");
+            InitDMA();
+            Mode_Enter();
+        }
+        printf("C %u %u %u %u free %u\r\n", capChannels,
+               packed0 ? recSamples : numResults, buffer2 ? 1 : 0,
+               packed0 ? 1 : 0, Arena_Free());
+        break;
+    case 'T':
+    case 't':
+        if (n >= 4) {
+            if (args[0] > 1 || (args[0] && !buffer1) || args[1] > TRIG_SLOPE
+                || args[3] >= Trig_Window() || packed0
+                || (etsWave && args[1] != TRIG_RISING && args[1] != TRIG_FALLING)
+                || (etsWave && args[3] < etsSamples)) {
+                printf("ERR\r\n");
+            } else {
+                trigChannel = args[0];
+                trigType = args[1];
+                trigLevel = (int) args[2];  // slope steps may be negative
+                trigPost = args[3];
+                trigState = TRIG_OFF;
+                if (sysMode == 1)
+                    Mode_Enter();           // re-arm with the new settings
+            }
+        }
+        printf("T %u %d %d %u state %d pre %u at %u\r\n", trigChannel, trigType,
+               trigLevel, trigPost, trigState, Trig_Pre(), trigIndex);
+        break;
+    case 'A':
+    case 'a':
+        if (n >= 1) {
+            if (sysMode == 1 && acqContinuous)
+                Acq_Stop();                 // the sum may be in use
+            if (Avg_Config(args[0]) != ERR_OK)
+                printf("ERR\r\n");
+            if (sysMode == 1)
+                Mode_Enter();
+        }
+        printf("A %u %u of %u free %u\r\n", avgShift, avgCount, 1U << avgShift,
+               Arena_Free());
+        break;
+    case 'E':
+    case 'e':
+        if (n >= 1) {
+            if (sysMode == 1 && acqContinuous)
+                Acq_Stop();                 // the waveform may be in use
+            if (Ets_Config(args[0], n > 1 ? args[1] : 0) != ERR_OK)
+                printf("ERR\r\n");
+            if (sysMode == 1)
+                Mode_Enter();
+        }
+        printf("E %u %u filled %u reps %u free %u\r\n", etsSamples, etsSlots,
+               etsFilled, etsReps, Arena_Free());
+        break;
+    case 'D':
+    case 'd':
+        if (n >= 1) {
+            if (sysMode == 2)
+                Acq_Stop();                 // the record may be in use
+            if (Dec_Config(args[0], n > 1 ? args[1] : DEC_SAMPLES) != ERR_OK)
+                printf("ERR\r\n");
+            if (sysMode == 2)
+                Mode_Enter();
+        }
+        printf("D %u %u bits %u filled %u free %u\r\n", decShift, decSamples,
+               12 + (decShift >> 1), decFilled, Arena_Free());
+        break;
+    case 'L':
+    case 'l':
+        if (n >= 1) {
+            if (sysMode == 2)
+                Acq_Stop();                 // the stages may be in use
+            if (Log_Config(args, args[0] ? n : 0) != ERR_OK)
+                printf("ERR\r\n");
+            if (sysMode == 2)
+                Mode_Enter();
+        } else if (logStat) {
+            Log_Drain();
+        }
+        printf("L %u next %lu dropped %u free %u\r\n", logStages, logSeq, logDropped,
+               Arena_Free());
+        break;
+    case 'R':
+    case 'r':
+        if (n >= 1) {
+            i = adcRate;
+            adcRate = args[0];
+            if (args[0] < ADCRATE_MIN || sysMode != 0 || gzMem
+                || Proc_Cycles(nlmsTaps, capChannels, recRegions) > PROC_CYCLES) {
+                adcRate = i;
+                printf("ERR\r\n");
+            } else {
+                // the skew is a time (A2's conversion): same cycles, new fraction
+                skewFrac = (int) (((long) skewFrac * i) / adcRate);
+                if (skewFrac > Q15_ONE)
+                    skewFrac = Q15_ONE;
+                TBCCR0 = adcRate - 1;
+                TBCCR1 = (adcRate >> 1);
+                TBCTL |= TBCLR;
+            }
+        }
+        printf("R %u %lu Hz proc %u\r\n", adcRate, SAMPLE_HZ, (unsigned int) PROC_CYCLES);
+        break;
+    case 'K':
+    case 'k':
+        if (n >= 1) {
+            i = skewFrac;
+            skewFrac = args[0];
+            if (args[0] > Q15_ONE
+                || Proc_Cycles(nlmsTaps, capChannels, recRegions) > PROC_CYCLES) {
+                skewFrac = i;               // 'K 0' runs the cheaper Krn_Sub() path
+                printf("ERR\r\n");
+            }
+        }
+        printf("K %d\r\n", skewFrac);
+        break;
+    case 'N':
+    case 'n':
+        if (n >= 1) {
+            if (sysMode == 2)
+                Acq_Stop();                 // the filter may be in use
+            if (Nlms_Config(args[0], n > 1 ? args[1] : NLMS_MU_SHIFT) != ERR_OK)
+                printf("ERR\r\n");
+            if (sysMode == 2)
+                Mode_Enter();
+        }
+        printf("N %u %u cycles %u of %u free %u\r\n", nlmsTaps, nlmsMuShift,
+               Proc_Cycles(nlmsTaps, capChannels, recRegions), (unsigned int) PROC_CYCLES,
+               Arena_Free());
+        break;
+    case 'S':
+    case 's':
+        if (n >= 1) {
+            i = statsOn;
+            statsOn = args[0];
+            if (args[0] > STATS_STREAM
+                || Proc_Cycles(nlmsTaps, capChannels, recRegions) > PROC_CYCLES) {
+                statsOn = i;
+                printf("ERR\r\n");
+            } else {
+                statsOn = i;
+                if (sysMode == 2)
+                    Acq_Stop();             // restart the sums on a block boundary
+                statsOn = args[0];
+                if (sysMode == 2)
+                    Mode_Enter();
+            }
+        }
+        Stats_Report();
+        break;
+    case 'F':
+    case 'f':
+        if (n >= 1) {
+            if (args[0] > 2047) {
+                printf("ERR\r\n");
+            } else {
+                if (sysMode == 2)
+                    Acq_Stop();             // restart the estimate on a block boundary
+                freqHyst = args[0];
+                freqLaps = 0;
+                freqCentiHz = 0;
+                freqConf = 0;
+                if (sysMode == 2)
+                    Mode_Enter();
+            }
+        } else if (sysMode == 0 && !packed0) {
+            // DMA has stopped, buffer0 is one pass over the ring: the seam where
+            // it stopped costs at most one period
+            freqCentiHz = freqCalc(buffer0, numResults, dcLevel[0] >> DC_FRAC,
+                                   freqHyst ? freqHyst : FREQ_HYST, SAMPLE_HZ, &freqConf);
+        }
+        printf("F %u %lu.%02u Hz conf %u\r\n", freqHyst, freqCentiHz / 100,
+               (unsigned int) (freqCentiHz % 100), freqConf);
+        break;
+    case 'P':
+    case 'p':
+        if (n >= 1) {
+            if (sysMode == 1 || sysMode == 2)
+                Acq_Stop();                 // another scratch user may be running
+            if (Fft_Config(args[0]) != ERR_OK)
+                printf("ERR\r\n");
+            if (sysMode == 1 || sysMode == 2)
+                Mode_Enter();
+        }
+        printf("P %u bins %u free %u\r\n", fftPoints, fftPoints / 2, Arena_Free());
+        break;
+    case 'G':
+    case 'g':
+        if (n >= 1) {
+            if (sysMode == 2)
+                Acq_Stop();                 // the bank may be in use
+            if (args[0] == 0) {
+                if (n == 1)
+                    Gz_Config(0, 0);
+                else if (Gz_Config(args[1], n > 2 ? args[2] : GZ_LEN) != ERR_OK)
+                    printf("ERR\r\n");
+            } else if (!gzMem && Gz_Config(GZ_SHIFT, GZ_LEN) != ERR_OK) {
+                printf("ERR\r\n");
+            } else {
+                for (i = 0; i < n; i++)
+                    if (Gz_Add(args[i], SAMPLE_HZ) != ERR_OK)
+                        printf("ERR %u\r\n", args[i]);
+            }
+            if (sysMode == 2)
+                Mode_Enter();
+        }
+        n = gzMem ? Gz_Bins() : 0;
+        printf("G %u results %lu free %u\r\n", n, gzMem ? Gz_Results() : 0UL, Arena_Free());
+        for (i = 0; i < n; i++)
+            printf("%u %u %d\r\n", gzMem[i].hz, gzMem[i].amp,
+                   (int) (((long) gzMem[i].phase * 1800) >> 15));
+        break;
+    case 'I':
+    case 'i':
+        if (n >= 1) {
+            if (args[0] == 1 || args[0] > ILV_MAX_CHANNELS) {
+                printf("ERR\r\n");
+            } else {
+                ilvWanted = args[0];
+                if (ilvActive)
+                    Ilv_Stop();             // restarted with the new count, or not
+                Mode_Enter();
+            }
+        }
+        printf("I %u active %u frames %u\r\n", ilvWanted, ilvActive ? ilvChannels : 0,
+               ilvActive ? ilvFrames : 0);
+        break;
+    case 'B':
+    case 'b':
+        if (n >= 2) {
+            if (sysMode == 2)
+                Acq_Stop();                 // start the filters on a block boundary
+            if (args[0] == FILT_CHANNELS) {
+                if (Filt_User(args[1], n > 2 ? args[2] : 0) != 0)
+                    printf("ERR\r\n");
+            } else if (args[0] == FILT_CHANNELS + 1) {
+                for (i = 2; i < n; i++)
+                    if (Filt_Coef(args[1] + i - 2, (int) args[i]) != 0)
+                        printf("ERR %u\r\n", args[1] + i - 2);
+            } else if (Filt_Config(args[0], args[1]) != ERR_OK) {
+                printf("ERR\r\n");
+            }
+            if (sysMode == 2)
+                Mode_Enter();
+        }
+        printf("B %u %u user %u %u cycles %u of %u free %u\r\n",
+               filtMem ? Filt_Design(0) : 0, filtMem ? Filt_Design(1) : 0,
+               Filt_UserType(), Filt_UserLen(), Proc_Cycles(nlmsTaps, capChannels, recRegions),
+               (unsigned int) PROC_CYCLES, Arena_Free());
+        break;
+    case 'X':
+    case 'x':
+        if (n >= 1) {
+            if (args[0] > XC_MAX_LAG) {
+                printf("ERR\r\n");
+            } else {
+                xcLags = args[0];
+                xcDelay = 0;
+                xcPeak = 0;
+                if (xcLags)
+                    Xc_Start(xcLags);
+            }
+        } else if (sysMode == 0 && buffer1 && procOut != buffer1 && !packed0) {
+            if (Xc_Delay(buffer0, buffer1,
+                         (numResults > XC_MAX_SAMPLES) ? XC_MAX_SAMPLES : numResults,
+                         dcLevel[0] >> DC_FRAC, dcLevel[1] >> DC_FRAC,
+                         xcLags ? xcLags : XC_LAGS, &xcDelay, &xcPeak) != ERR_OK)
+                printf("ERR\r\n");
+        }
+        printf("X %u delay %d peak %d\r\n", xcLags,
+               (int) (((long) xcDelay * 100) / (1 << XC_FRAC)),
+               (int) (((long) xcPeak * 1000) >> 15));
+        break;
+    case 'V':
+    case 'v':
+        if (n >= 1) {
+            if (sysMode == 2)
+                Acq_Stop();                 // the stages may be in use
+            if (Env_Config(args[0], n > 1 ? args[1] : ENV_SMOOTH,
+                           n > 2 ? args[2] : ENV_DECIM) != ERR_OK)
+                printf("ERR\r\n");
+            if (sysMode == 2)
+                Mode_Enter();
+        } else if (envMem) {
+            struct EnvPoint pt;
+            unsigned long seq;
+
+            while (Env_Read(&pt, &seq)) {
+                printf("%lu,%u.%u,%u.%u\r\n", seq,
+                       pt.env >> ENV_FRAC, ((pt.env & 15) * 10) >> ENV_FRAC,
+                       pt.rms >> ENV_FRAC, ((pt.rms & 15) * 10) >> ENV_FRAC);
+                if (acqContinuous)
+                    Acq_Service();
+            }
+        }
+        printf("V %u next %lu dropped %u free %u\r\n", envShift,
+               envMem ? Env_Next() : 0UL, envMem ? Env_Dropped() : 0, Arena_Free());
+        break;
+#if KRN_CHECK
+    case 'Z':
+    case 'z':
+        if (sysMode == 0) {
+            static const char krnNames[KRN_KERNELS][7] = {
+                "Sub", "Add", "Scale", "Mac", "MinMax"
+            };
+            unsigned int mark = Arena_Mark();
+            int *mem = Arena_Alloc(KRN_CHECK_BYTES(256)
+                                   + KRN_KERNELS * sizeof(struct KrnResult));
+            struct KrnResult *res = (struct KrnResult *) (mem + 4 * 256);   // off the stack
+
+            if (!mem) {
+                printf("ERR\r\n");
+                break;
+            }
+            Krn_Check(mem, 256, res);
+            for (i = 0; i < KRN_KERNELS; i++)
+                printf("Z %s errors %u ref %u.%u fast %u.%u\r\n", krnNames[i],
+                       res[i].errors,
+                       res[i].refCycles / 10, res[i].refCycles % 10,
+                       res[i].fastCycles / 10, res[i].fastCycles % 10);
+            Arena_Release(mark);
+        } else {
+            printf("ERR\r\n");            // needs the arena and Timer A undisturbed
+        }
+        break;
+#endif
+    case 'H':
+    case 'h':
+        Hlth_Report();
+        if (n >= 1 && args[0] == 0) {
+            hlthAdcOv = 0;
+            hlthAdcTov = 0;
+            Hlth_Restart();
+        }
+        break;
+    default:
+        printf("?\r\n");
+        break;
+    }
+}
+
+/***************************************************************************************
+ * Function: read_pin()                                                                *
+ * Input Parameters: NONE                                                              *
+ * Output: 1 if sysMode changed, 0 otherwise                                           *
+ * Description:                                                                        *
+ *      Called on every Timer A tick. SW1 (P4.4) and SW2 (P4.5) must read the          *
+ *      same on two ticks in a row (1/TICK_HZ apart) before the mode changes.          *
+ ***************************************************************************************/
+int read_pin(void) {
+    static unsigned last = 0xFF;
+    unsigned SW1;
+    unsigned SW2;
+    int mode;
+
+    SW1 = P4IN & 0x10;
+    SW2 = P4IN & 0x20;
+
+    if ((SW1 | SW2) != last)
+    {
+        last = SW1 | SW2;       // still bouncing, wait for the next tick
+        return 0;
+    }
+
+    if (SW1 == 0x10 && SW2 == 0)
+        mode = 1;
+    else if (SW2 == 0x20 && SW1 == 0)
+        mode = 2;
+    else if (SW1 == 0x10 && SW2 == 0x20)
+        mode = 3;
+    else
+        mode = 0;
+
+    if (mode == sysMode)
+        return 0;
+    sysMode = mode;
+    return 1;
+}
+//****************************************************************************************
+#ifdef UART_PRINTF
+//@brief Will send a character over UART
+int fputc(int _c, register FILE *_fp) {
+    // hold until register UC1IFG matches
+    // UCA1TXIFG register
+;   while (!(UC1IFG & UCA1TXIFG))
+        ;
+
+    // Add single integer as unsigned char
+    //to Transmission Buffer
+    UCA1TXBUF = (unsigned char) _c;
+
+    // return int value as unsigned char
+    return (unsigned char) _c;
+}
+
+// @brief will send a string over UART
+int fputs(const char *_ptr, register FILE *_fp) {
+    unsigned int i, len;
+
+    // Length of string
+    len = strlen(_ptr);
+
+    // loop until i equals length of string
+    for (i = 0; i < len; i++) {
+        // hold until register UC1IFG matches
+        // UCA1TXIFG register
+        while (!(UC1IFG & UCA1TXIFG))
+            ;
+
+        // add each a single char from string to
+        // Transmission buffer
+        UCA1TXBUF = (unsigned char) _ptr[i];
+    }
+
+    // return length of string
+    return (len);
+}
+
+#endif
+
+//********************************* Interrupt Routines ***********************************
+/***************************************************************************************
+ * Function: DMA_ISR()                                                                 *
+ * Description:                                                                        *
+ *      Posts a block-ready event each time the last capture channel (DMA2, or         *
+ *      DMA0 for one channel) completes a run, or when DMA0 wraps the                  *
+ *      interleaved ring. DMA2 finishing a run means DMA0 has too (same trigger,       *
+ *      higher priority), anything else is counted as a desync.                        *
+ ***************************************************************************************/
+#pragma vector = DMA_VECTOR
+__interrupt void DMA_ISR(void) {
+    unsigned int tbr = TBR;             // for the trigger-to-ISR latency
+
+    switch (__even_in_range(DMAIV, DMAIV_DMA2IFG)) {
+    case DMAIV_DMA0IFG:
+        if (!ilvActive) {
+            Acq_BlockDone(tbr);         // one-channel capture
+            __bic_SR_register_on_exit(LPM0_bits);
+            break;
+        }
+        // interleaved capture: one frame done, the next is already loaded
+        ilvNext += ilvChannels;
+        if (ilvNext >= ilvEnd)
+            ilvNext = &buffer0[0];
+        DMA0DA = (void (*)()) ilvNext;
+        if (++ilvFrame == ilvFrames) {
+            ilvFrame = 0;
+            ISRFLAG |= ISRFLG_DMA_BIT;
+            __bic_SR_register_on_exit(LPM0_bits);
+        }
+        break;
+    case DMAIV_DMA2IFG:
+        if (acqContinuous && !(DMA0CTL & DMAIFG))
+            acqDesync++;
+        DMA0CTL &= ~DMAIFG;
+        Acq_BlockDone(tbr);
+        __bic_SR_register_on_exit(LPM0_bits);
+        break;
+    default:
+        break;
+    }
+}
+
+/***************************************************************************************
+ * Function: Acq_BlockDone()                                                           *
+ * Input Parameters: tbr - TBR on entry to DMA_ISR                                     *
+ * Description:                                                                        *
+ *      Called from DMA_ISR when the last capture channel finishes a run.              *
+ *      Updates the health counters, then in                                           *
+ *      continuous mode hardware has already reloaded the next block, so the           *
+ *      reload registers are pointed one block further ahead (for ping-pong that       *
+ *      is the half that just completed).                                              *
+ ***************************************************************************************/
+void Acq_BlockDone(unsigned int tbr) {
+    unsigned int next;
+    unsigned int lat;
+
+    lat = (tbr >= TBCCR1) ? tbr - TBCCR1 : tbr + TBCCR0 + 1 - TBCCR1;
+    if (lat < hlthLatMin)
+        hlthLatMin = lat;
+    if (lat > hlthLatMax)
+        hlthLatMax = lat;
+    hlthSamples += acqContinuous ? blockSize : numResults;
+
+    if (acqContinuous) {
+        acqBlocksFilled++;
+        if (acqBlocksFilled - acqBlocksDone >= acqBlocks)
+            acqOverruns++;              // DMA is now writing an unprocessed block
+
+        next = acqReloadOfs + blockSize;
+        if (next >= acqRing)
+            next = 0;
+        acqReloadOfs = next;
+        DMA0DA = (void (*)()) &buffer0[next];
+        if (buffer1)
+            DMA2DA = (void (*)()) &buffer1[next];
+    }
+    ISRFLAG |= ISRFLG_DMA_BIT;
+}
+
+/***************************************************************************************
+ * Function: USCIAB1RX_ISR()                                                           *
+ * Description:                                                                        *
+ *      Collects a command line from the host. CR ends the line and wakes              *
+ *      main(); characters arriving before it has been parsed are dropped.             *
+ ***************************************************************************************/
+#pragma vector = USCIAB1RX_VECTOR
+__interrupt void USCIAB1RX_ISR(void) {
+    char c;
+
+    if (!(UC1IFG & UCA1RXIFG))
+        return;
+    c = UCA1RXBUF;
+    if (serReady)
+        return;
+
+    if (c == CR) {
+        serBuffer[serCount] = 0;
+        serReady = 1;
+        ISRFLAG |= ISRFLG_USB_BIT;
+        __bic_SR_register_on_exit(LPM0_bits);
+    } else if (c == BS) {
+        if (serCount)
+            serCount--;
+    } else if (serCount < SER_BUFFER_SIZE - 1) {
+        serBuffer[serCount++] = c;
+    }
+}
+
+/***************************************************************************************
+ * Function: TimerA0_ISR()                                                             *
+ * Description:                                                                        *
+ *      TICK_HZ tick, wakes main() to poll the mode switches.                          *
+ ***************************************************************************************/
+#pragma vector = TIMERA0_VECTOR
+__interrupt void TimerA0_ISR(void) {
+    if ((ADC12CTL0 & ENC) && (DMA0CTL & DMAEN) && !ilvActive)
+        hlthTicks++;                    // capture time for the expected sample count
+    ISRFLAG |= ISRFLG_TIC_BIT;
+    __bic_SR_register_on_exit(LPM0_bits);
+}
+
+/***************************************************************************************
+ * Function: ADC12_ISR()                                                               *
+ * Description:                                                                        *
+ *      Counts ADC12 overflows (a result overwritten before DMA read it) and           *
+ *      conversion-time overflows (a sample request arriving while the sequence        *
+ *      is still converting). No other ADC12 interrupt is enabled.                     *
+ ***************************************************************************************/
+#pragma vector = ADC12_VECTOR
+__interrupt void ADC12_ISR(void) {
+    switch (__even_in_range(ADC12IV, ADC12IV_ADC12TOVIFG)) {
+    case ADC12IV_ADC12OVIFG:
+        hlthAdcOv++;
+        break;
+    case ADC12IV_ADC12TOVIFG:
+        hlthAdcTov++;
+        break;
+    default:
+        break;
+    }
 }
 
-#endif
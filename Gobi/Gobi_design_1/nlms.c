@@ -0,0 +1,183 @@
+/*
+ * nlms.c
+ *
+ *  Normalized LMS noise canceller (see nlms.h).
+ *
+ *  Per sample, with L taps:
+ *      y = sum w[k] * x[n-k]                   MACS, about 10 cycles per tap
+ *      e = d[n] - y
+ *  and on every NLMS_UPDATE-th sample:
+ *      w[k] += g * x[n-k],  g = e * mu / P     MPYS, about 12 cycles per tap
+ *  plus about 50 cycles of fixed work (NLMS_CYCLES). P, the reference power
+ *  over the taps, is estimated once per block from the mean |x| so there
+ *  is no divide per sample, and g is e shifted by log2 of mu / P.
+ *  Updating on one sample in NLMS_UPDATE (partial update LMS) converges
+ *  NLMS_UPDATE times slower for the same mu but takes the update almost
+ *  out of the per-sample cost; the filter is unrolled by two. These are
+ *  estimates from the instructions, not measurements: 8 taps come to
+ *  about 142 cycles and fit in the 152 left of the 160-cycle default
+ *  period (50k samples/s at 8MHz); longer filters need a longer period
+ *  ('R'). Nlms_Config() refuses what does not fit.
+ */
+
+#include <msp430.h>
+#include "nlms.h"
+
+static int *nlmsW;                  // weights, Q15
+static int *nlmsHist;               // reference history, written twice
+static unsigned int nlmsTaps = 0;
+static unsigned int nlmsMu = 0;     // mu = 2^-nlmsMu
+static unsigned int nlmsPos = 0;    // newest sample is nlmsHist[nlmsPos]
+static unsigned int nlmsLeft = 1;   // samples until the next weight update
+static int nlmsShift = 0;           // log2 of the step g / e, from the power estimate
+
+/***************************************************************************************
+ * Function: Nlms_Init()                                                               *
+ * Input Parameters: mem     - NLMS_BYTES(taps) of word-aligned RAM                    *
+ *                   taps    - filter length, 1..NLMS_MAX_TAPS                         *
+ *                   muShift - step size mu = 2^-muShift                               *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Starts from zero weights, so the output is the primary input until the         *
+ *      filter has adapted.                                                            *
+ ***************************************************************************************/
+void Nlms_Init(int *mem, unsigned int taps, unsigned int muShift) {
+    unsigned int k;
+
+    nlmsW = mem;
+    nlmsHist = mem + taps;
+    nlmsTaps = taps;
+    nlmsMu = muShift;
+    for (k = 0; k < taps; k++)
+        nlmsW[k] = 0;
+    Nlms_Restart();
+}
+
+/***************************************************************************************
+ * Function: Nlms_Restart()                                                            *
+ * Input Parameters: NONE                                                              *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Clears the history after a gap in the input. The weights are kept, the         *
+ *      noise path has not changed.                                                    *
+ ***************************************************************************************/
+void Nlms_Restart(void) {
+    unsigned int k;
+
+    for (k = 0; k < 2 * nlmsTaps; k++)
+        nlmsHist[k] = 0;
+    nlmsPos = 0;
+    nlmsLeft = 1;
+    nlmsShift = -16;                // no adaptation until the power is known
+}
+
+/***************************************************************************************
+ * Function: Nlms_Block()                                                              *
+ * Input Parameters: out   - cleaned output, may be the same buffer as x               *
+ *                   d     - primary input (A2)                                        *
+ *                   x     - reference input (A1)                                      *
+ *                   count - samples                                                   *
+ *                   mid   - DC levels of d and x                                      *
+ *                   sum   - d and x are added to sum[0] and sum[1]                    *
+ * Output: NONE                                                                        *
+ * Description:                                                                        *
+ *      Inputs are 12-bit ADC12 results, scaled to Q15 around their DC level;          *
+ *      the output is back on the ADC scale around the DC level of d. The sums         *
+ *      let the caller track the DC levels from the same pass.                         *
+ ***************************************************************************************/
+void Nlms_Block(volatile unsigned int *out, const volatile unsigned int *d,
+                const volatile unsigned int *x, unsigned int count,
+                const unsigned int *mid, unsigned long *sum) {
+    unsigned int taps = nlmsTaps;
+    int *w = nlmsW;
+    int *h;
+    const int *wp, *hp;
+    unsigned int i, k;
+    unsigned long absSum = 0;
+    unsigned long dSum = 0, xSum = 0;
+    unsigned int mean;
+    unsigned int pos = nlmsPos;
+    unsigned int left = nlmsLeft;
+    int shift = nlmsShift;
+    int xs, y, g;
+    long e;
+    unsigned int dMid = mid[0];
+    unsigned int xMid = mid[1];
+    unsigned int dv, xv;
+
+    if (taps == 0)
+        return;
+
+    for (i = 0; i < count; i++) {
+        xv = x[i];
+        dv = d[i];
+        dSum += dv;
+        xSum += xv;
+        xs = (int) (xv - xMid) << 3;
+        absSum += (xs < 0) ? -xs : xs;
+
+        // newest first; the second copy keeps the window contiguous
+        h = nlmsHist + pos;
+        h[0] = xs;
+        h[taps] = xs;
+
+        wp = w;
+        hp = h;
+        MPYS = *wp++;
+        OP2 = *hp++;
+        for (k = (taps - 1) >> 1; k; k--) {
+            MACS = *wp++;
+            OP2 = *hp++;
+            MACS = *wp++;
+            OP2 = *hp++;
+        }
+        if ((taps & 1) == 0) {
+            MACS = *wp;
+            OP2 = *hp;
+        }
+        y = (int) ((RESHI << 1) | (RESLO >> 15));
+
+        e = (long) ((int) (dv - dMid) << 3) - y;
+        if (e > 32767)
+            e = 32767;
+        else if (e < -32768)
+            e = -32768;
+
+        if (--left == 0) {
+            left = NLMS_UPDATE;
+            if (shift > -16) {
+                g = (int) ((shift >= 0) ? e << shift : e >> -shift);
+                if (shift >= 0 && (long) g != e << shift)
+                    g = (e < 0) ? -32768 : 32767;   // step saturates
+                MPYS = g;
+                for (k = 0; k < taps; k++) {
+                    OP2 = h[k];
+                    w[k] += (int) RESHI;    // g * x >> 16
+                }
+            }
+        }
+
+        out[i] = (unsigned int) ((int) e >> 3) + dMid;
+        pos = pos ? pos - 1 : taps - 1;
+    }
+    nlmsPos = pos;
+    nlmsLeft = left;
+    sum[0] += dSum;
+    sum[1] += xSum;
+
+    // Step for the next block. In Q15, w += mu * e * x * 2^15 / P with
+    // P = sum x^2 over the taps ~ taps * mean|x|^2, and RESHI drops 16 bits,
+    // so g = e * 2^(31 - nlmsMu) / P. mean is rounded up to a power of two,
+    // which errs towards a smaller, stable step.
+    mean = (unsigned int) (absSum / count);
+    if (mean == 0) {
+        nlmsShift = -16;            // no reference, nothing to learn
+        return;
+    }
+    shift = 31 - (int) nlmsMu;
+    for (i = mean; i; i >>= 1)
+        shift -= 2;                 // / mean^2
+    for (i = taps; i > 1; i >>= 1)
+        shift--;                    // / taps
+    nlmsShift = (shift < -15) ? -15 : (shift > 15 ? 15 : shift);
+}
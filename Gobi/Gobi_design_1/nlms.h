@@ -0,0 +1,29 @@
+/*
+ * nlms.h
+ *
+ *  Normalized LMS adaptive noise canceller in Q15. The primary input
+ *  carries signal plus noise, the reference input noise only; the filter
+ *  learns the path from reference to primary and the error (primary minus
+ *  filtered reference) is the cleaned signal. Runs on the 16-bit hardware
+ *  multiplier, which must not be used by interrupt routines meanwhile.
+ */
+
+#ifndef NLMS_H_
+#define NLMS_H_
+
+#define NLMS_MAX_TAPS       32
+#define NLMS_BYTES(taps)    ((taps) * 3 * sizeof(int))  // weights + doubled history
+#define NLMS_UPDATE         8                           // samples per weight update
+
+// estimated MCLK cycles per sample: 50 fixed, 10 per tap for the filter and
+// 12 per tap for an update, spread over NLMS_UPDATE samples
+#define NLMS_CYCLES(taps)   (50 + 10 * (taps) \
+                             + (12 * (taps) + NLMS_UPDATE - 1) / NLMS_UPDATE)
+
+void Nlms_Init(int *mem, unsigned int taps, unsigned int muShift);
+void Nlms_Restart(void);
+void Nlms_Block(volatile unsigned int *out, const volatile unsigned int *d,
+                const volatile unsigned int *x, unsigned int count,
+                const unsigned int *mid, unsigned long *sum);
+
+#endif /* NLMS_H_ */
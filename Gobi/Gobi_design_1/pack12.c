@@ -0,0 +1,66 @@
+/*
+ * pack12.c
+ *
+ *  Pack/unpack routines for 12-bit sample records (see pack12.h).
+ */
+
+#include "pack12.h"
+
+/***************************************************************************************
+ * Function: Pack12_Write()                                                            *
+ * Input Parameters: dst   - packed record                                             *
+ *                   index - first sample to write (even)                              *
+ *                   src   - 16-bit samples, upper 4 bits are dropped                  *
+ *                   count - number of samples (even)                                  *
+ * Output: NONE                                                                        *
+ ***************************************************************************************/
+void Pack12_Write(unsigned char *dst, unsigned int index,
+                  const volatile unsigned int *src, unsigned int count) {
+    unsigned char *p = dst + (index >> 1) * 3;
+    unsigned int a, b;
+
+    for (; count >= 2; count -= 2) {
+        a = *src++;
+        b = *src++;
+        *p++ = (unsigned char) a;
+        *p++ = (unsigned char) (((a >> 8) & 0x0F) | (b << 4));
+        *p++ = (unsigned char) (b >> 4);
+    }
+}
+
+/***************************************************************************************
+ * Function: Pack12_Read()                                                             *
+ * Input Parameters: src   - packed record                                             *
+ *                   index - first sample to read (even)                               *
+ *                   dst   - unpacked samples                                          *
+ *                   count - number of samples (even)                                  *
+ * Output: NONE                                                                        *
+ ***************************************************************************************/
+void Pack12_Read(const unsigned char *src, unsigned int index,
+                 unsigned int *dst, unsigned int count) {
+    const unsigned char *p = src + (index >> 1) * 3;
+    unsigned int mid;
+
+    for (; count >= 2; count -= 2) {
+        mid = p[1];
+        *dst++ = p[0] | ((mid & 0x0F) << 8);
+        *dst++ = (mid >> 4) | ((unsigned int) p[2] << 4);
+        p += 3;
+    }
+}
+
+/***************************************************************************************
+ * Function: Pack12_Get()                                                              *
+ * Input Parameters: src - packed record, index - sample (any)                         *
+ * Output: 12-bit sample                                                               *
+ * Description:                                                                        *
+ *      Random access to one sample, for streaming a record out one value at a        *
+ *      time without an unpack buffer.                                                 *
+ ***************************************************************************************/
+unsigned int Pack12_Get(const unsigned char *src, unsigned int index) {
+    const unsigned char *p = src + (index >> 1) * 3;
+
+    if (index & 1)
+        return (p[1] >> 4) | ((unsigned int) p[2] << 4);
+    return p[0] | ((p[1] & 0x0F) << 8);
+}
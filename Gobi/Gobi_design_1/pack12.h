@@ -0,0 +1,25 @@
+/*
+ * pack12.h
+ *
+ *  Packed storage for 12-bit ADC12 results: two samples in three bytes.
+ *
+ *      byte 0 = a[7:0]
+ *      byte 1 = b[3:0] << 4 | a[11:8]
+ *      byte 2 = b[11:4]
+ *
+ *  Sample indexes passed to the block routines must be even so a pair
+ *  never straddles two calls.
+ */
+
+#ifndef PACK12_H_
+#define PACK12_H_
+
+#define PACK12_BYTES(n)     ((((unsigned long) (n) + 1) >> 1) * 3)
+
+void Pack12_Write(unsigned char *dst, unsigned int index,
+                  const volatile unsigned int *src, unsigned int count);
+void Pack12_Read(const unsigned char *src, unsigned int index,
+                 unsigned int *dst, unsigned int count);
+unsigned int Pack12_Get(const unsigned char *src, unsigned int index);
+
+#endif /* PACK12_H_ */
@@ -0,0 +1,138 @@
+/*
+ * kernel_test.c
+ *
+ *  Host test of the block kernels (make -C tests). Runs Krn_Check(), the
+ *  self-check the 'Z' command runs on target, for several block lengths,
+ *  then the cases its random data does not reach: odd lengths, in-place
+ *  output, wrap-around of the unsigned subtraction and addition, a
+ *  saturating MAC from a sum already near either end, rounding and
+ *  saturation of the scale at the ends of Q15, and ties and a single sample
+ *  for min/max. Exits 1 on any mismatch.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "kernel.h"
+
+#define TEST_MAX_N      512
+
+static int16_t mem[4 * TEST_MAX_N];
+static unsigned int failures = 0;
+
+static void Test_Expect(int ok, const char *what, unsigned int n) {
+    if (!ok) {
+        printf("FAIL %s, n = %u\n", what, n);
+        failures++;
+    }
+}
+
+static void Test_Check(unsigned int n) {
+    static const char *names[KRN_KERNELS] = {
+        "Krn_Check Sub", "Krn_Check Add", "Krn_Check Scale", "Krn_Check Mac",
+        "Krn_Check MinMax"
+    };
+    struct KrnResult res[KRN_KERNELS];
+    unsigned int k;
+
+    Krn_Check(mem, n, res);
+    for (k = 0; k < KRN_KERNELS; k++)
+        Test_Expect(res[k].errors == 0, names[k], n);
+}
+
+static void Test_Sub(unsigned int n) {
+    uint16_t a[TEST_MAX_N], b[TEST_MAX_N], r[TEST_MAX_N], f[TEST_MAX_N];
+    uint32_t sumR[2] = { 7, 9 }, sumF[2] = { 7, 9 };
+    unsigned int i, ok = 1;
+
+    for (i = 0; i < TEST_MAX_N; i++) {
+        a[i] = (i & 1) ? 0 : 4095;          // a - b + ofs wraps both ways
+        b[i] = (i & 1) ? 4095 : 0;
+        f[i] = a[i];
+    }
+    Krn_SubRef(r, a, b, n, 2048, sumR);
+    Krn_Sub(f, f, b, n, 2048, sumF);        // in place over a
+    for (i = 0; i < n; i++)
+        ok &= (r[i] == f[i]);
+    Test_Expect(ok && sumR[0] == sumF[0] && sumR[1] == sumF[1], "Sub in place", n);
+}
+
+static void Test_Add(unsigned int n) {
+    uint16_t a[TEST_MAX_N], b[TEST_MAX_N], r[TEST_MAX_N], f[TEST_MAX_N];
+    unsigned int i, ok = 1;
+
+    for (i = 0; i < TEST_MAX_N; i++) {
+        a[i] = (uint16_t) (0xFFF0 + i);     // a + b wraps past 0xFFFF
+        b[i] = (uint16_t) (i * 37);
+        f[i] = b[i];
+    }
+    Krn_AddRef(r, a, b, n);
+    Krn_Add(f, a, f, n);                    // in place over b
+    for (i = 0; i < n; i++)
+        ok &= (r[i] == f[i]);
+    Test_Expect(ok, "Add in place", n);
+}
+
+static void Test_Scale(unsigned int n, int16_t gain) {
+    static const int16_t ends[] = { -32768, -32767, -1, 0, 1, 16383, 16384, 32767 };
+    int16_t a[TEST_MAX_N], r[TEST_MAX_N], f[TEST_MAX_N];
+    unsigned int i, ok = 1;
+
+    for (i = 0; i < TEST_MAX_N; i++)
+        a[i] = ends[i % (sizeof(ends) / sizeof(ends[0]))];
+    Krn_ScaleRef(r, a, n, gain);
+    Krn_Scale(f, a, n, gain);
+    for (i = 0; i < n; i++)
+        ok &= (r[i] == f[i]);
+    Test_Expect(ok, "Scale ends", n);
+}
+
+static void Test_MinMax(unsigned int n) {
+    uint16_t a[TEST_MAX_N];
+    uint16_t atR[2], atF[2];
+    unsigned int i;
+
+    for (i = 0; i < TEST_MAX_N; i++)
+        a[i] = (uint16_t) (i % 5);          // repeated extremes: the first one counts
+    Krn_MinMaxRef(a, n, atR);
+    Krn_MinMax(a, n, atF);
+    Test_Expect(atR[0] == atF[0] && atR[1] == atF[1], "MinMax ties", n);
+    for (i = 0; i < TEST_MAX_N; i++)
+        a[i] = (uint16_t) (n - i);          // falling: minimum last
+    Krn_MinMaxRef(a, n, atR);
+    Krn_MinMax(a, n, atF);
+    Test_Expect(atR[0] == atF[0] && atR[1] == atF[1], "MinMax falling", n);
+}
+
+static void Test_Mac(unsigned int n, int32_t acc, int16_t x, int16_t y) {
+    int16_t a[TEST_MAX_N], b[TEST_MAX_N];
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        a[i] = x;
+        b[i] = (i == n / 2) ? (int16_t) -y : y;     // one step back from the end
+    }
+    Test_Expect(Krn_MacRef(acc, a, b, n) == Krn_Mac(acc, a, b, n), "Mac saturation", n);
+}
+
+int main(void) {
+    static const unsigned int lengths[] = { 2, 3, 17, 64, 255, TEST_MAX_N };
+    unsigned int i, n;
+
+    Test_MinMax(1);
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        n = lengths[i];
+        Test_Check(n);
+        Test_Sub(n);
+        Test_Add(n);
+        Test_Scale(n, -32768);
+        Test_Scale(n, 32767);
+        Test_Scale(n, -23170);
+        Test_MinMax(n);
+        Test_Mac(n, 0, -32768, -32768);
+        Test_Mac(n, INT32_MAX - 5, 3, 7);
+        Test_Mac(n, INT32_MIN + 5, 3, -7);
+        Test_Mac(n, -1, 32767, -32768);
+    }
+    printf("kernel_test: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * msp430f2618.h
+ *
+ *  Host stand-in for the device header, for the sources in build/. The
+ *  16x16 multiplier is emulated: MPY and MPYS load operand 1 and start a
+ *  new product, MAC and MACS add to RESHI:RESLO, and writing OP2 does the
+ *  multiply. Timer A reads as stopped, so Krn_Check() reports no cycles.
+ */
+
+#ifndef MSP430F2618_H_
+#define MSP430F2618_H_
+
+#include <stdint.h>
+
+static uint16_t mpyOp1;
+static int mpySigned;
+static int mpyAcc;
+static uint32_t mpyRes;
+
+static inline void mpy_w_MPY(uint16_t v)  { mpyOp1 = v; mpySigned = 0; mpyAcc = 0; }
+static inline void mpy_w_MPYS(uint16_t v) { mpyOp1 = v; mpySigned = 1; mpyAcc = 0; }
+static inline void mpy_w_MAC(uint16_t v)  { mpyOp1 = v; mpySigned = 0; mpyAcc = 1; }
+static inline void mpy_w_MACS(uint16_t v) { mpyOp1 = v; mpySigned = 1; mpyAcc = 1; }
+
+static inline void mpy_w_OP2(uint16_t v) {
+    uint32_t p = mpySigned ? (uint32_t) ((int32_t) (int16_t) mpyOp1 * (int16_t) v)
+                           : (uint32_t) mpyOp1 * v;
+
+    mpyRes = mpyAcc ? mpyRes + p : p;
+}
+
+static inline void mpy_w_RESLO(uint16_t v) { mpyRes = (mpyRes & 0xFFFF0000u) | v; }
+static inline void mpy_w_RESHI(uint16_t v) { mpyRes = (mpyRes & 0xFFFFu) | ((uint32_t) v << 16); }
+static inline uint16_t mpy_r_RESLO(void)   { return (uint16_t) mpyRes; }
+static inline uint16_t mpy_r_RESHI(void)   { return (uint16_t) (mpyRes >> 16); }
+
+#define TAR                     0
+#define TACCR0                  0xFFFF
+#define __disable_interrupt()
+#define __enable_interrupt()
+
+#endif /* MSP430F2618_H_ */
@@ -0,0 +1,175 @@
+/*
+ * xcorr.c
+ *
+ *  Cross-correlation delay estimator (see xcorr.h).
+ *
+ *  For lags k = -L..L
+ *      R(k) = sum (a[i] - midA) * (b[i + k] - midB),  i = L..count-L-1
+ *  so every lag sums the same count - 2L products, and each is divided by
+ *  the power of its two windows into a correlation coefficient. Samples
+ *  are quartered into 10 bits and sign, so XC_MAX_SAMPLES products of at
+ *  most 1023 * 1023 fit the 32-bit sum of the hardware multiplier (MACS),
+ *  about 14 cycles per product.
+ *  A sweep over the 2L + 1 lags can be spread over several calls of
+ *  Xc_Step(), each on a new block, so no single block pays for all of it.
+ *  A call costs (2m + 1) * (count - 2L) products for m lags: one lag over
+ *  128 samples at L = 8 takes about 0.3ms at 16MHz, all 17 over 256
+ *  samples in one call (Xc_Delay()) about 7ms.
+ */
+
+#include "gfa.h"
+#include "fixmath.h"
+#include "xcorr.h"
+
+struct XcSweep {
+    unsigned int maxLag;                // 0 = not started
+    unsigned int k;                     // next lag, 0..2L for -L..L
+    unsigned int best;
+    int next;                           // the lag after the best is still to come
+    int prev, cBest, cPrev, cNext;      // Q15 coefficients
+};
+
+static struct XcSweep xcSweep;
+
+/***************************************************************************************
+ * Function: Xc_Dot()                                                                  *
+ * Input Parameters: x, y   - samples                                                  *
+ *                   n      - products to add                                          *
+ *                   mx, my - DC levels taken off x and y                              *
+ * Output: sum of the products, each in 20 bits and sign                               *
+ ***************************************************************************************/
+static long Xc_Dot(const volatile unsigned int *x, const volatile unsigned int *y,
+                   unsigned int n, unsigned int mx, unsigned int my) {
+    unsigned int i;
+
+    MPYS = 0;
+    OP2 = 0;                        // clears RESHI:RESLO for the MACS below
+    for (i = 0; i < n; i++) {
+        MACS = (int) (x[i] - mx) >> 2;
+        OP2 = (int) (y[i] - my) >> 2;
+    }
+    return ((long) (int) RESHI << 16) | RESLO;
+}
+
+/***************************************************************************************
+ * Function: Xc_Coef()                                                                 *
+ * Input Parameters: r   - correlation sum                                             *
+ *                   den - product of the two windows' root powers, not 0              *
+ * Output: r / den in Q15, saturated to +-32767                                        *
+ ***************************************************************************************/
+static int Xc_Coef(long r, unsigned long den) {
+    while (den > 0x3FFF) {
+        den >>= 1;
+        r >>= 1;
+    }
+    if (r >= (long) den || r <= -(long) den)
+        return (r < 0) ? -32767 : 32767;
+    return (int) ((r << 15) / (long) den);
+}
+
+/***************************************************************************************
+ * Function: Xc_Start()                                                                *
+ * Input Parameters: maxLag - lags searched each way, 1..XC_MAX_LAG                    *
+ * Output: ERR_OK, or ERR_VALUE if maxLag is out of range                              *
+ * Description:                                                                        *
+ *      Begins a new sweep for Xc_Step(), dropping the one under way.                  *
+ ***************************************************************************************/
+int Xc_Start(unsigned int maxLag) {
+    if (maxLag == 0 || maxLag > XC_MAX_LAG)
+        return ERR_VALUE;
+    xcSweep.maxLag = maxLag;
+    xcSweep.k = 0;
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Xc_Step()                                                                 *
+ * Input Parameters: a, b       - the two channels, sampled together                   *
+ *                   count      - samples of each, 4 * maxLag..XC_MAX_SAMPLES          *
+ *                   midA, midB - their DC levels                                      *
+ *                   lags       - lags of the sweep to correlate on this block         *
+ * Output: ERR_OK when the sweep is complete, XC_BUSY while lags remain, or            *
+ *         ERR_VALUE if the settings are invalid or a channel is flat, which           *
+ *         starts the sweep over                                                       *
+ *         delay - how far b lags a, in Q(XC_FRAC) samples (negative: b leads),        *
+ *                 written with ERR_OK only                                            *
+ *         peak  - correlation coefficient at the best lag, Q15, likewise              *
+ * Description:                                                                        *
+ *      The best lag is the largest positive correlation, as the canceller             *
+ *      subtracts the channels. If it is at +-maxLag it is not refined and the         *
+ *      true delay may lie beyond the window. Lags of one sweep may come from          *
+ *      different blocks; each is normalized on its own, so they compare as            *
+ *      long as the signal does not change faster than a sweep. A completed            *
+ *      sweep starts the next one.                                                     *
+ ***************************************************************************************/
+int Xc_Step(const volatile unsigned int *a, const volatile unsigned int *b,
+            unsigned int count, unsigned int midA, unsigned int midB,
+            unsigned int lags, int *delay, int *peak) {
+    unsigned int maxLag = xcSweep.maxLag;
+    unsigned int n, k, rootA, rootB;
+    long curv;
+    int c;
+    int frac = 0;
+
+    if (maxLag == 0 || count > XC_MAX_SAMPLES || count < 4 * maxLag)
+        return ERR_VALUE;
+    n = count - 2 * maxLag;
+    a += maxLag;
+
+    rootA = Fix_Sqrt(Xc_Dot(a, a, n, midA, midA));
+    for (k = xcSweep.k; lags && k <= 2 * maxLag; lags--, k++) {
+        rootB = Fix_Sqrt(Xc_Dot(b + k, b + k, n, midB, midB));
+        if (rootA == 0 || rootB == 0) {
+            xcSweep.k = 0;
+            return ERR_VALUE;
+        }
+        c = Xc_Coef(Xc_Dot(a, b + k, n, midA, midB), (unsigned long) rootA * rootB);
+        if (xcSweep.next) {
+            xcSweep.cNext = c;
+            xcSweep.next = 0;
+        }
+        if (k == 0 || c > xcSweep.cBest) {
+            xcSweep.cBest = c;
+            xcSweep.cPrev = xcSweep.prev;
+            xcSweep.best = k;
+            xcSweep.next = 1;
+        }
+        xcSweep.prev = c;
+    }
+    if (k <= 2 * maxLag) {
+        xcSweep.k = k;
+        return XC_BUSY;
+    }
+    xcSweep.k = 0;
+    xcSweep.next = 0;
+
+    // parabola through the peak and its neighbours
+    if (xcSweep.best != 0 && xcSweep.best != 2 * maxLag) {
+        curv = (long) xcSweep.cPrev - 2L * xcSweep.cBest + xcSweep.cNext;
+        if (curv < 0) {
+            frac = (int) ((((long) xcSweep.cPrev - xcSweep.cNext) << (XC_FRAC - 1)) / curv);
+            if (frac > (1 << (XC_FRAC - 1)))
+                frac = 1 << (XC_FRAC - 1);
+            else if (frac < -(1 << (XC_FRAC - 1)))
+                frac = -(1 << (XC_FRAC - 1));
+        }
+    }
+    *delay = (int) (((int) xcSweep.best - (int) maxLag) << XC_FRAC) + frac;
+    *peak = xcSweep.cBest;
+    return ERR_OK;
+}
+
+/***************************************************************************************
+ * Function: Xc_Delay()                                                                *
+ * Input Parameters: as Xc_Step(), with maxLag - lags searched each way                *
+ * Output: ERR_OK, or ERR_VALUE if the settings are invalid or a channel is flat       *
+ * Description:                                                                        *
+ *      The whole sweep on one block. Drops a sweep Xc_Step() had under way.           *
+ ***************************************************************************************/
+int Xc_Delay(const volatile unsigned int *a, const volatile unsigned int *b,
+             unsigned int count, unsigned int midA, unsigned int midB,
+             unsigned int maxLag, int *delay, int *peak) {
+    if (Xc_Start(maxLag) != ERR_OK)
+        return ERR_VALUE;
+    return Xc_Step(a, b, count, midA, midB, 2 * maxLag + 1, delay, peak);
+}
@@ -0,0 +1,28 @@
+/*
+ * xcorr.h
+ *
+ *  Delay between two channels from their cross-correlation over a window
+ *  of lags, in fixed point. The best lag is refined to a fraction of a
+ *  sample by a parabola through the peak and its neighbours, and the peak
+ *  is reported as a correlation coefficient, 1.0 = Q15_ONE, so a poor
+ *  match can be told from a good one. Xc_Step() spreads the lags over
+ *  several blocks; Xc_Delay() does them all at once.
+ */
+
+#ifndef XCORR_H_
+#define XCORR_H_
+
+#define XC_MAX_LAG          32
+#define XC_MAX_SAMPLES      2048        // keeps the 32-bit sums from overflowing
+#define XC_FRAC             8           // delays in 1/256 sample
+#define XC_BUSY             1           // Xc_Step(): lags of the sweep remain
+
+int Xc_Start(unsigned int maxLag);
+int Xc_Step(const volatile unsigned int *a, const volatile unsigned int *b,
+            unsigned int count, unsigned int midA, unsigned int midB,
+            unsigned int lags, int *delay, int *peak);
+int Xc_Delay(const volatile unsigned int *a, const volatile unsigned int *b,
+             unsigned int count, unsigned int midA, unsigned int midB,
+             unsigned int maxLag, int *delay, int *peak);
+
+#endif /* XCORR_H_ */